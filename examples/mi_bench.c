@@ -0,0 +1,202 @@
+/**[txh]********************************************************************
+
+  GDB/MI interface library
+  Copyright (c) 2004-2016 by Salvador E. Tropea.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+  Comment:
+  Microbenchmark for the input layer. A recorded MI transcript (gdb output
+only, as seen with mi_set_from_gdb_cb) is replayed through a pipe and read
+using mi_get_response, so the results can be compared between versions of
+the library. gdb isn't needed.
+  Usage: mi_bench [transcript [repetitions]]
+  If no transcript is provided a synthetic one is used.
+
+***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include "mi_gdb.h"
+
+char *load_transcript(const char *name, long *len)
+{
+ FILE *f=fopen(name,"rb");
+ char *b;
+
+ if (!f)
+    return NULL;
+ fseek(f,0,SEEK_END);
+ *len=ftell(f);
+ fseek(f,0,SEEK_SET);
+ b=malloc(*len+1);
+ if (b && fread(b,1,*len,f)!=*len)
+   {
+    free(b);
+    b=NULL;
+   }
+ fclose(f);
+ return b;
+}
+
+/* Something similar to what we get for a deep stack and a big -break-list. */
+char *synth_transcript(long *len)
+{
+ int i, j, sz=1<<22;
+ char *b=malloc(sz), *s=b;
+
+ if (!b)
+    return NULL;
+ for (i=0; i<200; i++)
+    {
+     s+=sprintf(s,"~\"Some console output, response %d\\n\"\n",i);
+     s+=sprintf(s,"^done,stack=[");
+     for (j=0; j<100; j++)
+         s+=sprintf(s,"%sframe={level=\"%d\",addr=\"0x%08x\",func=\"func_%d\","
+                    "file=\"some/dir/file_%d.c\",line=\"%d\"}",j ? "," : "",
+                    j,0x8048000+j*16,j,j,j*10);
+     s+=sprintf(s,"]\n(gdb) \n");
+    }
+ *len=s-b;
+ return b;
+}
+
+int count_prompts(const char *b, long len)
+{
+ int c=0;
+ const char *e=b+len;
+
+ while (b<e)
+   {
+    if (strncmp(b,"(gdb)",5)==0)
+       c++;
+    b=memchr(b,'\n',e-b);
+    if (!b)
+       break;
+    b++;
+   }
+ return c;
+}
+
+/* Counts the lines consumed by the library. */
+void cb_from(const char *str, void *data)
+{
+ (*(long *)data)++;
+}
+
+double now()
+{
+ struct timeval tv;
+ gettimeofday(&tv,NULL);
+ return tv.tv_sec+tv.tv_usec/1e6;
+}
+
+int main(int argc, char *argv[])
+{
+ long len;
+ int reps=10, i, expected, got=0;
+ long lines=0, last_lines=0;
+ int idle=0;
+ char *tr;
+ int p[2];
+ pid_t pid;
+ mi_h *h;
+ double t;
+
+ tr=argc>1 ? load_transcript(argv[1],&len) : synth_transcript(&len);
+ if (!tr)
+   {
+    fprintf(stderr,"Can't load the transcript\n");
+    return 1;
+   }
+ if (argc>2)
+    reps=atoi(argv[2]);
+ expected=count_prompts(tr,len)*reps;
+ if (!expected)
+   {
+    fprintf(stderr,"The transcript doesn't contain (gdb) prompts\n");
+    return 1;
+   }
+ if (pipe(p))
+    return 1;
+
+ pid=fork();
+ if (pid==0)
+   {/* The writer plays the gdb role. */
+    close(p[0]);
+    for (i=0; i<reps; i++)
+       {
+        char *s=tr;
+        long l=len, w;
+        while (l>0 && (w=write(p[1],s,l))>0)
+          {
+           s+=w;
+           l-=w;
+          }
+       }
+    _exit(0);
+   }
+ close(p[1]);
+
+ /* A handle without a real gdb, just the input side. */
+ h=mi_alloc_h();
+ if (!h)
+    return 1;
+ h->from_gdb[0]=p[0];
+ fcntl(p[0],F_SETFL,fcntl(p[0],F_GETFL,0) | O_NONBLOCK);
+ mi_set_from_gdb_cb(h,cb_from,&lines);
+
+ t=now();
+ while (got<expected)
+   {
+    if (mi_get_response(h))
+      {
+       mi_free_output(mi_retire_response(h));
+       got++;
+      }
+    else if (lines==last_lines)
+      {/* Nothing reported, most probably nothing is waiting in the library.
+          Empty lines aren't reported, so we give it some extra chances. */
+       struct pollfd pf;
+       pf.fd=p[0];
+       pf.events=POLLIN;
+       if (poll(&pf,1,1000)<=0 || (pf.revents & POLLIN)==0)
+         {
+          if (++idle>8)
+             break;
+         }
+       else
+          idle=0;
+      }
+    else
+       idle=0;
+    last_lines=lines;
+   }
+ t=now()-t;
+
+ printf("%d/%d responses, %.1f MB in %.3f s: %.1f MB/s, %.0f responses/s\n",
+        got,expected,len*(double)reps/1e6,t,len*reps/1e6/t,got/t);
+ /* Also closes our side of the pipe, so the writer can't get stuck. */
+ mi_free_h(&h);
+ waitpid(pid,NULL,0);
+ free(tr);
+ return got==expected ? 0 : 1;
+}
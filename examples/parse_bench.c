@@ -0,0 +1,239 @@
+/**[txh]********************************************************************
+
+  GDB/MI interface library
+  Copyright (c) 2004-2016 by Salvador E. Tropea.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+  Comment:
+  Microbenchmark for the parser. The lines of a recorded MI transcript (gdb
+output only, as seen with mi_set_from_gdb_cb) are parsed in memory using
+each parser mode and each c-string scanning kernel (see mi_scan_select).
+  Usage: parse_bench [transcript [repetitions]]
+  If no transcript is provided two synthetic ones are used: a disassembly
+with source lines and a memory dump, the big responses we get from gdb.
+
+***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "mi_gdb.h"
+
+char *load_transcript(const char *name, long *len)
+{
+ FILE *f=fopen(name,"rb");
+ char *b;
+
+ if (!f)
+    return NULL;
+ fseek(f,0,SEEK_END);
+ *len=ftell(f);
+ fseek(f,0,SEEK_SET);
+ b=malloc(*len+1);
+ if (b && fread(b,1,*len,f)!=*len)
+   {
+    free(b);
+    b=NULL;
+   }
+ else if (b)
+    b[*len]=0;
+ fclose(f);
+ return b;
+}
+
+/* What -data-disassemble with mode 1 returns for a big function. */
+char *synth_disasm(long *len)
+{
+ int i, j, sz=1<<23;
+ char *b=malloc(sz), *s=b;
+
+ if (!b)
+    return NULL;
+ for (i=0; i<20; i++)
+    {
+     s+=sprintf(s,"^done,asm_insns=[");
+     for (j=0; j<500; j++)
+         s+=sprintf(s,"%ssrc_and_asm_line={line=\"%d\",file=\"some/dir/file.c\","
+                    "fullname=\"/home/user/project/some/dir/file.c\",line_asm_insn="
+                    "[{address=\"0x%08x\",func-name=\"main\",offset=\"%d\","
+                    "inst=\"mov    0x%x(%%rbp),%%eax\"},{address=\"0x%08x\","
+                    "func-name=\"main\",offset=\"%d\",inst=\"lea    0x0(,%%rax,4),%%rdx"
+                    "\"},{address=\"0x%08x\",func-name=\"main\",offset=\"%d\","
+                    "inst=\"callq  0x400500 <printf@plt>\"}]}",j ? "," : "",
+                    j+10,0x400000+j*12,j*12,j*4,0x400004+j*12,j*12+4,
+                    0x400008+j*12,j*12+8);
+     s+=sprintf(s,"]\n(gdb) \n");
+    }
+ *len=s-b;
+ return b;
+}
+
+/* What -data-read-memory returns, including strings with escapes in the
+   ascii column. */
+char *synth_memory(long *len)
+{
+ int i, j, k, sz=1<<23;
+ char *b=malloc(sz), *s=b;
+ unsigned addr=0x601000;
+
+ if (!b)
+    return NULL;
+ for (i=0; i<20; i++)
+    {
+     s+=sprintf(s,"^done,addr=\"0x%08x\",nr-bytes=\"4096\",total-bytes=\"4096\","
+                "next-row=\"0x%08x\",prev-row=\"0x%08x\",next-page=\"0x%08x\","
+                "prev-page=\"0x%08x\",memory=[",addr,addr+16,addr-16,addr+4096,
+                addr-4096);
+     for (j=0; j<256; j++, addr+=16)
+        {
+         s+=sprintf(s,"%s{addr=\"0x%08x\",data=[",j ? "," : "",addr);
+         for (k=0; k<16; k++)
+             s+=sprintf(s,"%s\"0x%02x\"",k ? "," : "",(j*16+k)&0xFF);
+         s+=sprintf(s,"],ascii=\"Hello, \\\"world\\\"\\n\\t\\001\\377\"}");
+        }
+     s+=sprintf(s,"]\n(gdb) \n");
+    }
+ *len=s-b;
+ return b;
+}
+
+double now()
+{
+ struct timeval tv;
+ gettimeofday(&tv,NULL);
+ return tv.tv_sec+tv.tv_usec/1e6;
+}
+
+void ev_cb(mi_event *e, void *data)
+{
+ (*(long *)data)++;
+}
+
+enum { m_tree, m_arena, m_event, m_inc, m_last };
+const char *mode_names[]={ "tree", "arena", "event", "incremental" };
+
+/* Parses all the lines of the transcript, returns the number of records. */
+long parse_all(char *tr, long len, int mode, mi_inc *inc)
+{
+ char *s=tr, *e=tr+len, *nl, *cp=NULL;
+ long recs=0, evs=0;
+ int used;
+ mi_output *o;
+
+ if (mode==m_inc)
+   {
+    while (s<e)
+      {
+       if (mi_inc_feed(inc,s,e-s,&used))
+         {
+          if (inc->o)
+             recs++;
+          mi_free_output(inc->o);
+          inc->o=NULL;
+         }
+       s+=used;
+      }
+    return recs;
+   }
+ for (; s<e; s=nl+1)
+    {
+     nl=memchr(s,'\n',e-s);
+     if (!nl)
+        nl=e;
+     *nl=0;
+     if (strncmp(s,"(gdb)",5))
+       {
+        switch (mode)
+          {
+           case m_tree:
+                o=mi_parse_gdb_output(s);
+                break;
+           case m_arena:
+                o=mi_parse_gdb_output_arena(s);
+                break;
+           default:
+                /* Destructive, we parse a copy. */
+                cp=strdup(s);
+                o=mi_parse_gdb_output_ev(cp,ev_cb,&evs);
+          }
+        if (o)
+           recs++;
+        mi_free_output(o);
+        free(cp);
+       }
+     *nl='\n';
+    }
+ return recs;
+}
+
+void bench(const char *name, char *tr, long len, int reps)
+{
+ static const char *kernels[]={ "scalar", "sse2", "avx2" };
+ int k, m, i;
+ long recs=0;
+ double t;
+ mi_inc *inc=mi_alloc_inc();
+
+ printf("%s: %.1f MB x %d\n",name,len/1e6,reps);
+ for (k=0; k<3; k++)
+    {
+     if (!mi_scan_select(kernels[k]))
+        continue;
+     for (m=0; m<m_last; m++)
+        {
+         t=now();
+         for (i=0; i<reps; i++)
+             recs=parse_all(tr,len,m,inc);
+         t=now()-t;
+         printf("  %-6s %-11s %ld records, %.3f s: %.1f MB/s\n",kernels[k],
+                mode_names[m],recs,t,len*(double)reps/1e6/t);
+        }
+    }
+ mi_free_inc(inc);
+ mi_scan_select(NULL);
+}
+
+int main(int argc, char *argv[])
+{
+ long len;
+ int reps=10;
+ char *tr;
+
+ if (argc>2)
+    reps=atoi(argv[2]);
+ if (argc>1)
+   {
+    tr=load_transcript(argv[1],&len);
+    if (!tr)
+      {
+       fprintf(stderr,"Can't load the transcript\n");
+       return 1;
+      }
+    bench(argv[1],tr,len,reps);
+    free(tr);
+    return 0;
+   }
+ tr=synth_disasm(&len);
+ if (tr)
+    bench("disassembly",tr,len,reps);
+ free(tr);
+ tr=synth_memory(&len);
+ if (tr)
+    bench("memory",tr,len,reps);
+ free(tr);
+ return 0;
+}
@@ -24,6 +24,8 @@ pointers. Alloc functions must set mi_error.@p
   
 ***************************************************************************/
 
+#include <string.h>
+#include <stdint.h>
 #include "mi_gdb.h"
 
 void *mi_calloc(size_t count, size_t sz)
@@ -103,11 +105,212 @@ mi_asm_insn *mi_alloc_asm_insn(void)
  return (mi_asm_insn *)mi_calloc1(sizeof(mi_asm_insn));
 }
 
+/* All the arrays and the text in one block, the addresses go first to
+   keep them aligned. */
+mi_asm_block *mi_alloc_asm_block(int count, int nlines, size_t text_size)
+{
+ mi_asm_block *b;
+ char *p;
+
+ p=mi_calloc1(sizeof(mi_asm_block)+count*sizeof(unsigned long)+
+              count*3*sizeof(unsigned)+nlines*(sizeof(int)+sizeof(unsigned))+
+              (nlines+1)*sizeof(int)+text_size);
+ if (!p)
+    return NULL;
+ b=(mi_asm_block *)p;
+ p+=sizeof(mi_asm_block);
+ b->count=count;
+ b->addr=(unsigned long *)p;
+ p+=count*sizeof(unsigned long);
+ b->offset=(unsigned *)p;
+ p+=count*sizeof(unsigned);
+ b->func=(unsigned *)p;
+ p+=count*sizeof(unsigned);
+ b->inst=(unsigned *)p;
+ p+=count*sizeof(unsigned);
+ b->nlines=nlines;
+ b->line=(int *)p;
+ p+=nlines*sizeof(int);
+ b->file=(unsigned *)p;
+ p+=nlines*sizeof(unsigned);
+ b->first=(int *)p;
+ p+=(nlines+1)*sizeof(int);
+ b->text=p;
+ b->text_size=text_size;
+ return b;
+}
+
 mi_chg_reg *mi_alloc_chg_reg(void)
 {
  return (mi_chg_reg *)mi_calloc1(sizeof(mi_chg_reg));
 }
 
+mi_mem_region *mi_alloc_mem_region(void)
+{
+ return (mi_mem_region *)mi_calloc1(sizeof(mi_mem_region));
+}
+
+mi_mem_write *mi_alloc_mem_write(void)
+{
+ return (mi_mem_write *)mi_calloc1(sizeof(mi_mem_write));
+}
+
+mi_inc *mi_alloc_inc(void)
+{
+ return (mi_inc *)mi_calloc1(sizeof(mi_inc));
+}
+
+/*****************************************************************************
+  Arenas: all the nodes of a record are allocated from slabs. The slabs are
+aligned to their size so we can find the arena of a node. Big strings get
+their own block.
+*****************************************************************************/
+
+#define MI_ARENA_SLAB 16384
+#define MI_ARENA_BIG  (MI_ARENA_SLAB/4)
+
+typedef struct mi_slab_struct
+{
+ mi_arena *arena;
+ struct mi_slab_struct *next;
+} mi_slab;
+
+static
+mi_slab *mi_arena_new_slab(mi_arena *a)
+{
+ void *p;
+
+ if (posix_memalign(&p,MI_ARENA_SLAB,MI_ARENA_SLAB))
+   {
+    mi_error=MI_OUT_OF_MEMORY;
+    return NULL;
+   }
+ ((mi_slab *)p)->arena=a;
+ return (mi_slab *)p;
+}
+
+mi_arena *mi_arena_create(void)
+{
+ mi_slab *s=mi_arena_new_slab(NULL);
+ mi_arena *a;
+
+ if (!s)
+    return NULL;
+ a=(mi_arena *)(s+1);
+ s->arena=a;
+ s->next=NULL;
+ a->slabs=s;
+ a->pos=(char *)(a+1);
+ a->end=(char *)s+MI_ARENA_SLAB;
+ a->owner=NULL;
+ return a;
+}
+
+void *mi_arena_alloc(mi_arena *a, size_t sz)
+{
+ char *p;
+ mi_slab *s;
+
+ /* Keep the nodes aligned. */
+ p=(char *)(((uintptr_t)a->pos+sizeof(void *)-1) & ~(uintptr_t)(sizeof(void *)-1));
+ if (p+sz<=a->end)
+   {
+    a->pos=p+sz;
+    return p;
+   }
+ if (sz>MI_ARENA_BIG)
+   {
+    s=(mi_slab *)mi_malloc(sizeof(mi_slab)+sz);
+    if (!s)
+       return NULL;
+    s->arena=a;
+   }
+ else
+   {
+    s=mi_arena_new_slab(a);
+    if (!s)
+       return NULL;
+    a->pos=(char *)(s+1)+sz;
+    a->end=(char *)s+MI_ARENA_SLAB;
+   }
+ s->next=(mi_slab *)a->slabs;
+ a->slabs=s;
+ return s+1;
+}
+
+/* Releases all the slabs but the first, the arena can be used again. */
+void mi_arena_reset(mi_arena *a)
+{
+ mi_slab *s, *aux, *first=(mi_slab *)a-1;
+
+ for (s=(mi_slab *)a->slabs; s!=first; s=aux)
+    {
+     aux=s->next;
+     free(s);
+    }
+ a->slabs=first;
+ a->pos=(char *)(a+1);
+ a->end=(char *)first+MI_ARENA_SLAB;
+}
+
+/* Only valid for nodes, they never go to a block for big strings. Elements
+   of a mi_rs_array can, so they aren't valid. */
+mi_arena *mi_arena_of(void *p)
+{
+ return ((mi_slab *)((uintptr_t)p & ~(uintptr_t)(MI_ARENA_SLAB-1)))->arena;
+}
+
+static
+char *mi_strdup(const char *s)
+{
+ char *r;
+ size_t l;
+
+ if (!s)
+    return NULL;
+ l=strlen(s)+1;
+ r=mi_malloc(l);
+ if (r)
+    memcpy(r,s,l);
+ return r;
+}
+
+/* Creates a malloc'ed copy of a results list. Used to take things out of an
+   arena. */
+mi_results *mi_copy_results(mi_results *r)
+{
+ mi_results *res=NULL, *last=NULL, *n;
+
+ for (; r; r=r->next)
+    {
+     n=mi_alloc_results();
+     if (!n)
+        break;
+     if (last)
+        last->next=n;
+     else
+        res=n;
+     last=n;
+     n->type=r->type;
+     n->atom=r->atom;
+     if (r->var && !(n->var=mi_strdup(r->var)))
+        break;
+     if (r->type==t_const)
+       {
+        if (r->v.cstr && !(n->v.cstr=mi_strdup(r->v.cstr)))
+           break;
+       }
+     else if (r->v.rs && !(n->v.rs=mi_copy_results(r->v.rs)))
+        break;
+    }
+ if (r)
+   {/* Out of memory. */
+    mi_free_results(res);
+    return NULL;
+   }
+ return res;
+}
+
 /*****************************************************************************
   Free functions
 *****************************************************************************/
@@ -180,6 +383,17 @@ void mi_free_results_but(mi_results *r, mi_results *no)
 {
  mi_results *aux;
 
+ if (r && r->arena)
+   {/* Nodes from an arena are released with the record, unless they were
+       kept by mi_free_output_but. Elements of arrays are never kept. */
+    mi_arena *a;
+    if (r->array)
+       return;
+    a=mi_arena_of(r);
+    if (a->owner==r)
+       mi_free_arena(a);
+    return;
+   }
  while (r)
    {
     if (r==no)
@@ -227,10 +441,23 @@ void mi_free_output_but(mi_output *r, mi_output *no, mi_results *no_r)
       }
     else
       {
-       if (r->c)
-          mi_free_results_but(r->c,no_r);
        aux=r->next;
-       free(r);
+       if (r->arena)
+         {
+          if (no_r && no_r->arena && mi_arena_of(no_r)==r->arena)
+            {/* Pin the arena, no_r will release it. */
+             no_r->next=NULL;
+             r->arena->owner=no_r;
+            }
+          else if (r->arena->owner==r)
+             mi_free_arena(r->arena);
+         }
+       else
+         {
+          if (r->c)
+             mi_free_results_but(r->c,no_r);
+          free(r);
+         }
        r=aux;
       }
    }
@@ -241,6 +468,42 @@ void mi_free_output(mi_output *r)
  mi_free_output_but(r,NULL,NULL);
 }
 
+void mi_free_arena(mi_arena *a)
+{
+ mi_slab *s, *aux;
+
+ if (!a)
+    return;
+ for (s=(mi_slab *)a->slabs; s; s=aux)
+    {
+     aux=s->next;
+     free(s);
+    }
+}
+
+void mi_free_inc(mi_inc *p)
+{
+ if (!p)
+    return;
+ mi_free_output(p->o);
+ free(p->levels);
+ free(p->buf);
+ free(p);
+}
+
+void mi_free_pending(mi_pending *p)
+{
+ mi_pending *aux;
+
+ while (p)
+   {
+    mi_free_output(p->o);
+    aux=p->next;
+    free(p);
+    p=aux;
+   }
+}
+
 void mi_free_stop(mi_stop *s)
 {
  if (!s)
@@ -320,3 +583,30 @@ void mi_free_chg_reg(mi_chg_reg *r)
    }
 }
 
+void mi_free_mem_region(mi_mem_region *r)
+{
+ mi_mem_region *aux;
+ while (r)
+   {
+    aux=r->next;
+    free(r);
+    r=aux;
+   }
+}
+
+void mi_free_asm_block(mi_asm_block *b)
+{
+ free(b);
+}
+
+void mi_free_mem_write(mi_mem_write *w)
+{
+ mi_mem_write *aux;
+ while (w)
+   {
+    aux=w->next;
+    free(w);
+    w=aux;
+   }
+}
+
@@ -0,0 +1,471 @@
+/**[txh]********************************************************************
+
+  GDB/MI interface library
+  Copyright (c) 2004-2016 by Salvador E. Tropea.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+  Module: Auto-continue breakpoints.
+  Comments:
+  Breakpoints used to count hits or to collect a few values. When the
+*stopped record of one of them arrives the library takes note and, as soon
+as it isn't reading, sends the commands to collect the values (expressions,
+frame addresses and registers) and the -exec-continue, all of them without
+waiting for the answers. The stop
+record isn't passed to the application, it gets an mi_hit when all the
+answers arrived. The *running of our -exec-continue and the
+=breakpoint-modified gdb sends for each hit are also discarded, after
+updating the breakpoints table.@p
+  The answers are read by @x{mi_process_input} and by any function that
+waits for gdb, so the application must keep reading gdb output while the
+inferior runs.@p
+
+***************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "mi_gdb.h"
+
+/* Collection in progress for a hit. */
+struct mi_ac_state_struct
+{
+ mi_h *h;
+ mi_autocont_bkpt *b;
+ /* Answers we are waiting for, plus one while we send the commands. */
+ int pending;
+ int next_exp, next_reg, max_frames;
+ mi_hit hit;
+ struct mi_ac_state_struct *next;
+};
+typedef struct mi_ac_state_struct mi_ac_state;
+
+static
+mi_autocont_bkpt *mi_ac_find(mi_autocont *a, int bkptno)
+{
+ mi_autocont_bkpt *b=a->bkpts;
+
+ while (b && b->bkptno!=bkptno)
+    b=b->next;
+ return b;
+}
+
+static
+void mi_ac_free_bkpt(mi_autocont_bkpt *b)
+{
+ int i;
+
+ for (i=0; i<b->ncmds; i++)
+     free(b->cmds[i]);
+ free(b->cmds);
+ free(b);
+}
+
+static
+void mi_ac_remove(mi_autocont *a, int bkptno)
+{
+ mi_autocont_bkpt **p, *b;
+
+ for (p=&a->bkpts; *p; p=&(*p)->next)
+     if ((*p)->bkptno==bkptno)
+       {
+        b=*p;
+        *p=b->next;
+        mi_ac_free_bkpt(b);
+        return;
+       }
+}
+
+/* Creates the commands for the collection. */
+static
+mi_autocont_bkpt *mi_ac_new_bkpt(int bkptno, const mi_collect *c)
+{
+ mi_autocont_bkpt *b;
+ int i;
+ char *s;
+
+ b=(mi_autocont_bkpt *)mi_calloc1(sizeof(mi_autocont_bkpt));
+ if (!b)
+    return NULL;
+ b->bkptno=bkptno;
+ b->nexps=c->nexps;
+ b->nframes=c->nframes;
+ b->nregs=c->nregs;
+ b->cmds=(char **)mi_calloc(c->nexps+2,sizeof(char *));
+ if (!b->cmds)
+    goto error;
+ for (i=0; i<c->nexps; i++)
+    {
+     if (asprintf(&b->cmds[i],"-data-evaluate-expression \"%s\"\n",
+                  c->exps[i])<0)
+        goto error;
+     b->ncmds++;
+    }
+ if (c->nframes)
+   {
+    if (asprintf(&b->cmds[b->ncmds],"-stack-list-frames 0 %d\n",
+                 c->nframes-1)<0)
+       goto error;
+    b->ncmds++;
+   }
+ if (c->nregs)
+   {
+    s=b->cmds[b->ncmds]=(char *)mi_malloc(32+c->nregs*12);
+    if (!s)
+       goto error;
+    b->ncmds++;
+    s+=sprintf(s,"-data-list-register-values x");
+    for (i=0; i<c->nregs; i++)
+        s+=sprintf(s," %d",c->regs[i]);
+    strcpy(s,"\n");
+   }
+ return b;
+
+error:
+ mi_error=MI_OUT_OF_MEMORY;
+ mi_ac_free_bkpt(b);
+ return NULL;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Makes @var{bkptno} an auto-continue breakpoint. At each hit the library
+collects what @var{c} says, continues the execution and passes the values
+to the callback set using @x{mi_set_hit_cb}. @var{c} is copied. Using NULL
+for @var{c} removes it, using 0 for @var{bkptno} removes all. Don't call it
+from the hit callback.
+
+  Return: !=0 OK.
+
+***************************************************************************/
+
+int mi_set_auto_continue(mi_h *h, int bkptno, const mi_collect *c)
+{
+ mi_autocont *a;
+ mi_autocont_bkpt *b;
+
+ /* The stops we took note of use the breakpoint commands. */
+ mi_autocont_flush(h);
+ a=h->autocont;
+ if (bkptno<=0)
+   {
+    if (a)
+      {
+       while (a->bkpts)
+         {
+          b=a->bkpts;
+          a->bkpts=b->next;
+          mi_ac_free_bkpt(b);
+         }
+       free(a);
+       h->autocont=NULL;
+      }
+    return 1;
+   }
+ if (a)
+    mi_ac_remove(a,bkptno);
+ if (!c)
+    return 1;
+ if (c->nexps<0 || c->nframes<0 || c->nregs<0)
+    return 0;
+ if (!a)
+   {
+    a=(mi_autocont *)mi_calloc1(sizeof(mi_autocont));
+    if (!a)
+       return 0;
+    h->autocont=a;
+   }
+ b=mi_ac_new_bkpt(bkptno,c);
+ if (!b)
+    return 0;
+ b->next=a->bkpts;
+ a->bkpts=b;
+ return 1;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Sets the callback that gets the values collected at each hit of an
+auto-continue breakpoint. The mi_hit is released when the callback returns.
+
+***************************************************************************/
+
+void mi_set_hit_cb(mi_h *h, hit_cb cb, void *data)
+{
+ h->hit=cb;
+ h->hit_data=data;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Returns how many hits of the auto-continue breakpoint @var{bkptno} we
+handled.
+
+***************************************************************************/
+
+unsigned long mi_get_auto_continue_hits(mi_h *h, int bkptno)
+{
+ mi_autocont_bkpt *b;
+
+ if (!h->autocont)
+    return 0;
+ b=mi_ac_find(h->autocont,bkptno);
+ return b ? b->hits : 0;
+}
+
+/* One answer less, when we have all the hit is passed to the application. */
+static
+void mi_ac_release(mi_ac_state *st)
+{
+ mi_h *h=st->h;
+ int i;
+
+ if (--st->pending)
+    return;
+ if (h->hit)
+    h->hit(&st->hit,h->hit_data);
+ for (i=0; i<st->hit.nexps; i++)
+     free(st->hit.values[i]);
+ free(st);
+}
+
+/* Returns the result record if it's ^done. */
+static
+mi_output *mi_ac_done(mi_output *o)
+{
+ mi_output *r=mi_get_rrecord(o);
+
+ return r && r->tclass==MI_CL_DONE ? r : NULL;
+}
+
+static
+void mi_ac_exp_cb(mi_output *o, void *data)
+{
+ mi_ac_state *st=(mi_ac_state *)data;
+ mi_output *r=mi_ac_done(o);
+ mi_results *v=r ? mi_get_var_r(r->c,"value") : NULL;
+ int i=st->next_exp++;
+
+ /* gdb answers in order, so this is the next expression. */
+ if (v && v->type==t_const)
+    st->hit.values[i]=strdup(v->v.cstr);
+ mi_free_output(o);
+ mi_ac_release(st);
+}
+
+static
+void mi_ac_frames_cb(mi_output *o, void *data)
+{
+ mi_ac_state *st=(mi_ac_state *)data;
+ mi_output *r=mi_ac_done(o);
+ mi_results *v=r ? mi_get_var_r(r->c,"stack") : NULL, *c, *a;
+ char *end;
+
+ if (v && v->type==t_list)
+    for (c=v->v.rs; c && st->hit.nframes<st->max_frames; c=c->next)
+       {
+        if (c->type!=t_tuple)
+           continue;
+        a=mi_get_var_r(c->v.rs,"addr");
+        if (a && a->type==t_const)
+           st->hit.frames[st->hit.nframes++]=
+             (void *)strtoul(a->v.cstr,&end,0);
+       }
+ mi_free_output(o);
+ mi_ac_release(st);
+}
+
+static
+void mi_ac_regs_cb(mi_output *o, void *data)
+{
+ mi_ac_state *st=(mi_ac_state *)data;
+ mi_output *r=mi_ac_done(o);
+ mi_results *v=r ? mi_get_var_r(r->c,"register-values") : NULL, *c, *a;
+ char *end;
+
+ /* In the order we asked for them. */
+ if (v && v->type==t_list)
+    for (c=v->v.rs; c && st->next_reg<st->hit.nregs; c=c->next)
+       {
+        if (c->type!=t_tuple)
+           continue;
+        a=mi_get_var_r(c->v.rs,"value");
+        if (a && a->type==t_const)
+           st->hit.regs[st->next_reg]=strtoull(a->v.cstr,&end,0);
+        st->next_reg++;
+       }
+ mi_free_output(o);
+ mi_ac_release(st);
+}
+
+static
+void mi_ac_cont_cb(mi_output *o, void *data)
+{
+ mi_ac_state *st=(mi_ac_state *)data;
+ mi_output *r=mi_get_rrecord(o);
+ mi_h *h=st->h;
+
+ if (r && r->tclass==MI_CL_RUNNING)
+    st->hit.resumed=1;
+ else if (h->autocont && h->autocont->resuming)
+    /* We won't get a *running for it. */
+    h->autocont->resuming--;
+ mi_free_output(o);
+ mi_ac_release(st);
+}
+
+static
+void mi_ac_send(mi_h *h, const char *cmd, done_cb cb, mi_ac_state *st)
+{
+ if (!mi_submit(h,cmd,cb,st))
+    cb(NULL,st);
+}
+
+/* *stopped at one of our breakpoints, starts the collection and continues.
+   Returns 0 if it isn't ours. */
+static
+int mi_ac_stop(mi_h *h, mi_output *o)
+{
+ mi_autocont *a=h->autocont;
+ mi_autocont_bkpt *b;
+ mi_ac_state *st;
+ mi_results *r;
+ mi_stop *s;
+ int bkptno=0, hit=0;
+ size_t off;
+
+ /* Look for the breakpoint before parsing the whole record. */
+ for (r=o->c; r; r=r->next)
+    {
+     if (r->type!=t_const)
+        continue;
+     if (r->atom==at_reason)
+        hit=strcmp(r->v.cstr,"breakpoint-hit")==0;
+     else if (r->atom==at_bkptno)
+        bkptno=atoi(r->v.cstr);
+    }
+ if (!hit || (b=mi_ac_find(a,bkptno))==NULL)
+    return 0;
+
+ /* The values go after the state, in the same block. */
+ off=(sizeof(mi_ac_state)+7) & ~(size_t)7;
+ st=(mi_ac_state *)mi_calloc1(off+b->nregs*sizeof(unsigned long long)+
+                              (b->nexps+b->nframes)*sizeof(void *));
+ if (!st)
+    return 0;
+ st->h=h;
+ st->max_frames=b->nframes;
+ st->hit.bkptno=bkptno;
+ st->hit.nexps=b->nexps;
+ st->hit.nregs=b->nregs;
+ st->hit.regs=(unsigned long long *)((char *)st+off);
+ st->hit.values=(char **)(st->hit.regs+b->nregs);
+ st->hit.frames=(void **)(st->hit.values+b->nexps);
+ s=mi_get_stopped(o->c);
+ if (s)
+   {
+    st->hit.thread_id=s->thread_id;
+    if (s->frame)
+       st->hit.addr=s->frame->addr;
+    mi_free_stop(s);
+   }
+ b->hits++;
+ /* The prompt that follows the stop isn't the end of a response. */
+ h->skip_prompts++;
+ /* We are reading, the commands are sent by mi_autocont_flush. */
+ st->b=b;
+ if (a->stops_last)
+    a->stops_last->next=st;
+ else
+    a->stops=st;
+ a->stops_last=st;
+ return 1;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Sends the commands for the hits of auto-continue breakpoints found while
+reading gdb output. Called by @x{mi_get_response} and @x{mi_process_input}
+once the read is finished, so we don't send commands from the read path.
+
+***************************************************************************/
+
+void mi_autocont_flush(mi_h *h)
+{
+ mi_autocont *a=h->autocont;
+ mi_autocont_bkpt *b;
+ mi_ac_state *st;
+ int i;
+
+ /* Sending can read more stops, they are added to the list. */
+ while (a && (st=a->stops)!=NULL)
+   {
+    a->stops=st->next;
+    if (!a->stops)
+       a->stops_last=NULL;
+    if (h->died)
+      {
+       free(st);
+       continue;
+      }
+    b=st->b;
+    /* The commands, the -exec-continue and us. */
+    st->pending=b->ncmds+2;
+    for (i=0; i<b->ncmds; i++)
+       {
+        if (i<b->nexps)
+           mi_ac_send(h,b->cmds[i],mi_ac_exp_cb,st);
+        else if (i==b->nexps && b->nframes)
+           mi_ac_send(h,b->cmds[i],mi_ac_frames_cb,st);
+        else
+           mi_ac_send(h,b->cmds[i],mi_ac_regs_cb,st);
+       }
+    a->resuming++;
+    mi_ac_send(h,"-exec-continue\n",mi_ac_cont_cb,st);
+    mi_ac_release(st);
+   }
+}
+
+/* Called for each async record. Returns !=0 for the records we consumed:
+   the stops at our breakpoints, the *running of our -exec-continue and the
+   =breakpoint-modified of our breakpoints. */
+int mi_autocont_notify(mi_h *h, mi_output *o)
+{
+ mi_autocont *a=h->autocont;
+ mi_results *r;
+
+ switch (o->tclass)
+   {
+    case MI_CL_STOPPED:
+         return mi_ac_stop(h,o);
+    case MI_CL_RUNNING:
+         if (!a->resuming)
+            return 0;
+         a->resuming--;
+         return 1;
+    case MI_CL_BKPT_MODIFIED:
+         r=mi_get_var_r(o->c,"bkpt");
+         if (!r || r->type!=t_tuple)
+            return 0;
+         r=mi_get_var_r(r->v.rs,"number");
+         return r && r->type==t_const && mi_ac_find(a,atoi(r->v.cstr));
+   }
+ return 0;
+}
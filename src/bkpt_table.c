@@ -0,0 +1,507 @@
+/**[txh]********************************************************************
+
+  GDB/MI interface library
+  Copyright (c) 2004-2016 by Salvador E. Tropea.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+  Module: Breakpoint table.
+  Comments:
+  The breakpoints of the session, so the front-ends don't need to keep
+their own list. The breakpoints can be found by number (i.e. the bkptno of
+a stop), by address and by file and line.@p
+  The table is updated with the results of the gmi_break_* functions and
+with the =breakpoint-created, =breakpoint-modified and =breakpoint-deleted
+notifications. gdb sends the last one when a breakpoint is hit, so the hit
+counts (times) are updated without asking for the list. Breakpoints created
+using CLI commands are also reported this way. gmi_break_list replaces the
+whole table.@p
+  The mi_bkpt structures belong to the table, don't release them. They are
+valid until the breakpoint is modified or deleted.@p
+
+***************************************************************************/
+
+#include <string.h>
+#include "mi_gdb.h"
+
+static
+unsigned mi_bkpt_hash_addr(mi_bkpt_table *t, void *addr)
+{
+ unsigned long a=(unsigned long)addr;
+
+ return (unsigned)((a>>2) ^ (a>>12)) & (t->hash_size-1);
+}
+
+/* Only the base name is used, gdb can report relative names. */
+static
+const char *mi_bkpt_base(const char *file)
+{
+ const char *s=strrchr(file,'/');
+
+ return s ? s+1 : file;
+}
+
+static
+unsigned mi_bkpt_hash_line(mi_bkpt_table *t, const char *file, int line)
+{
+ unsigned v=2166136261u;
+
+ for (file=mi_bkpt_base(file); *file; file++)
+     v=(v ^ (unsigned char)*file)*16777619u;
+ return (v ^ line*2654435761u) & (t->hash_size-1);
+}
+
+/* The names are the same or one is a path ending with the other. */
+static
+int mi_bkpt_same_file(const char *a, const char *b)
+{
+ size_t la=strlen(a), lb=strlen(b);
+
+ if (la==lb)
+    return strcmp(a,b)==0;
+ if (la<lb)
+   {
+    const char *aux=a;
+    a=b;
+    b=aux;
+    la=lb;
+    lb=strlen(b);
+   }
+ return strcmp(a+la-lb,b)==0 && a[la-lb-1]=='/';
+}
+
+static
+void mi_bkpt_link(mi_bkpt_table *t, mi_bkpt_node *n)
+{
+ unsigned i;
+
+ if (n->b->addr)
+   {
+    i=mi_bkpt_hash_addr(t,n->b->addr);
+    n->next_addr=t->addr[i];
+    t->addr[i]=n;
+   }
+ if (n->b->file)
+   {
+    i=mi_bkpt_hash_line(t,n->b->file,n->b->line);
+    n->next_line=t->line[i];
+    t->line[i]=n;
+   }
+}
+
+static
+void mi_bkpt_unlink(mi_bkpt_table *t, mi_bkpt_node *n)
+{
+ mi_bkpt_node **p;
+
+ if (n->b->addr)
+   {
+    for (p=&t->addr[mi_bkpt_hash_addr(t,n->b->addr)]; *p!=n;
+         p=&(*p)->next_addr);
+    *p=n->next_addr;
+   }
+ if (n->b->file)
+   {
+    for (p=&t->line[mi_bkpt_hash_line(t,n->b->file,n->b->line)]; *p!=n;
+         p=&(*p)->next_line);
+    *p=n->next_line;
+   }
+ n->next_addr=n->next_line=NULL;
+}
+
+static
+int mi_bkpt_alloc_hash(mi_bkpt_table *t, int size)
+{
+ mi_bkpt_node **addr, **line;
+ int i;
+
+ addr=(mi_bkpt_node **)mi_calloc(size,sizeof(mi_bkpt_node *));
+ line=(mi_bkpt_node **)mi_calloc(size,sizeof(mi_bkpt_node *));
+ if (!addr || !line)
+   {
+    free(addr);
+    free(line);
+    return 0;
+   }
+ free(t->addr);
+ free(t->line);
+ t->addr=addr;
+ t->line=line;
+ t->hash_size=size;
+ for (i=0; i<t->num_size; i++)
+     if (t->num[i])
+        mi_bkpt_link(t,t->num[i]);
+ return 1;
+}
+
+static
+void mi_bkpt_table_clear(mi_bkpt_table *t)
+{
+ int i;
+
+ for (i=0; i<t->num_size; i++)
+     if (t->num[i])
+       {
+        mi_free_bkpt(t->num[i]->b);
+        free(t->num[i]);
+        t->num[i]=NULL;
+       }
+ memset(t->addr,0,t->hash_size*sizeof(mi_bkpt_node *));
+ memset(t->line,0,t->hash_size*sizeof(mi_bkpt_node *));
+ t->count=0;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Enables or disables the breakpoint table. Only the breakpoints created
+after enabling it are known, use gmi_break_list to load the ones already
+created.
+
+  Return: !=0 OK.
+
+***************************************************************************/
+
+int mi_set_bkpt_table(mi_h *h, int enable)
+{
+ mi_bkpt_table *t=h->btable;
+
+ if (t)
+   {
+    mi_bkpt_table_clear(t);
+    free(t->num);
+    free(t->addr);
+    free(t->line);
+    free(t);
+    h->btable=NULL;
+   }
+ if (!enable)
+    return 1;
+ t=(mi_bkpt_table *)mi_calloc1(sizeof(mi_bkpt_table));
+ if (!t)
+    return 0;
+ if (!mi_bkpt_alloc_hash(t,64))
+   {
+    free(t);
+    return 0;
+   }
+ h->btable=t;
+ return 1;
+}
+
+static
+char *mi_bkpt_strdup(const char *s)
+{
+ return s ? strdup(s) : NULL;
+}
+
+/* The gmi_break_* functions give the breakpoint to the caller, we keep a
+   copy. */
+static
+mi_bkpt *mi_bkpt_copy(mi_bkpt *b)
+{
+ mi_bkpt *n=mi_alloc_bkpt();
+
+ if (!n)
+    return NULL;
+ *n=*b;
+ n->next=NULL;
+ n->func=mi_bkpt_strdup(b->func);
+ n->file=mi_bkpt_strdup(b->file);
+ n->cond=mi_bkpt_strdup(b->cond);
+ n->file_abs=mi_bkpt_strdup(b->file_abs);
+ if ((b->func && !n->func) || (b->file && !n->file) ||
+     (b->cond && !n->cond) || (b->file_abs && !n->file_abs))
+   {
+    mi_free_bkpt(n);
+    return NULL;
+   }
+ return n;
+}
+
+/* Takes b, replacing the breakpoint with the same number. */
+static
+int mi_bkpt_table_put(mi_bkpt_table *t, mi_bkpt *b)
+{
+ mi_bkpt_node *n, **num;
+ int size;
+
+ if (b->number<=0)
+   {
+    mi_free_bkpt(b);
+    return 0;
+   }
+ if (b->number>=t->num_size)
+   {
+    for (size=t->num_size ? t->num_size*2 : 64; size<=b->number; size*=2);
+    num=(mi_bkpt_node **)realloc(t->num,size*sizeof(mi_bkpt_node *));
+    if (!num)
+      {
+       mi_error=MI_OUT_OF_MEMORY;
+       mi_free_bkpt(b);
+       return 0;
+      }
+    memset(num+t->num_size,0,(size-t->num_size)*sizeof(mi_bkpt_node *));
+    t->num=num;
+    t->num_size=size;
+   }
+ n=t->num[b->number];
+ if (n)
+   {/* What gdb doesn't report is kept. */
+    mi_bkpt_unlink(t,n);
+    b->thread=n->b->thread;
+    b->mode=n->b->mode;
+    if (!b->file_abs)
+      {
+       b->file_abs=n->b->file_abs;
+       n->b->file_abs=NULL;
+      }
+    mi_free_bkpt(n->b);
+   }
+ else
+   {
+    n=(mi_bkpt_node *)mi_calloc1(sizeof(mi_bkpt_node));
+    if (!n)
+      {
+       mi_free_bkpt(b);
+       return 0;
+      }
+    t->num[b->number]=n;
+    t->count++;
+   }
+ n->b=b;
+ mi_bkpt_link(t,n);
+ if (t->count>t->hash_size && t->hash_size<(1<<20))
+    mi_bkpt_alloc_hash(t,t->hash_size*4);
+ return 1;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Adds a copy of @var{b} to the breakpoint table, replacing the breakpoint
+with the same number. Called by the gmi_break_insert* functions.
+
+  Return: !=0 OK.
+
+***************************************************************************/
+
+int mi_bkpt_table_add(mi_h *h, mi_bkpt *b)
+{
+ mi_bkpt *n;
+
+ if (!h->btable || !b)
+    return 0;
+ n=mi_bkpt_copy(b);
+ if (!n)
+    return 0;
+ return mi_bkpt_table_put(h->btable,n);
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Removes the breakpoint @var{number} from the table.
+
+  Return: !=0 if it was in the table.
+
+***************************************************************************/
+
+int mi_bkpt_table_del(mi_h *h, int number)
+{
+ mi_bkpt_table *t=h->btable;
+ mi_bkpt_node *n;
+
+ if (!t || number<=0 || number>=t->num_size || !t->num[number])
+    return 0;
+ n=t->num[number];
+ mi_bkpt_unlink(t,n);
+ mi_free_bkpt(n->b);
+ free(n);
+ t->num[number]=NULL;
+ t->count--;
+ return 1;
+}
+
+/* Creates a breakpoint from a bkpt tuple. mi_get_bkpt takes the strings,
+   the record belongs to somebody else so we use a copy. */
+static
+mi_bkpt *mi_bkpt_from_tuple(mi_results *r)
+{
+ mi_results *c;
+ mi_bkpt *b;
+
+ if (!r || r->type!=t_tuple)
+    return NULL;
+ c=mi_copy_results(r->v.rs);
+ if (!c)
+    return NULL;
+ b=mi_get_bkpt(c);
+ mi_free_results(c);
+ return b;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Updates the breakpoint table using the =breakpoint-* notifications.
+Called for each asynchronous record we get.
+
+***************************************************************************/
+
+void mi_bkpt_table_notify(mi_h *h, mi_output *o)
+{
+ mi_results *r;
+ mi_bkpt *b;
+
+ if (!h->btable || o->sstype!=MI_SST_NOTIFY)
+    return;
+ switch (o->tclass)
+   {
+    case MI_CL_BKPT_CREATED:
+    case MI_CL_BKPT_MODIFIED:
+         for (r=o->c; r; r=r->next)
+             if (r->atom==at_bkpt && (b=mi_bkpt_from_tuple(r))!=NULL)
+                mi_bkpt_table_put(h->btable,b);
+         break;
+    case MI_CL_BKPT_DELETED:
+         for (r=o->c; r; r=r->next)
+             if (r->type==t_const && r->var && strcmp(r->var,"id")==0)
+                mi_bkpt_table_del(h,atoi(r->v.cstr));
+         break;
+   }
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Replaces the contents of the table with the BreakpointTable returned by
+-break-list. Called by gmi_break_list.
+
+  Return: The number of breakpoints or -1 on error.
+
+***************************************************************************/
+
+int mi_bkpt_table_list(mi_h *h, mi_results *r)
+{
+ mi_results *c;
+ mi_bkpt *b;
+
+ if (!h->btable || !r || r->type!=t_tuple)
+    return -1;
+ mi_bkpt_table_clear(h->btable);
+ for (c=r->v.rs; c; c=c->next)
+     if (c->var && strcmp(c->var,"body")==0 && c->type==t_list)
+        break;
+ if (!c)
+    return 0;
+ for (c=c->v.rs; c; c=c->next)
+     if (c->atom==at_bkpt && (b=mi_bkpt_from_tuple(c))!=NULL)
+        mi_bkpt_table_put(h->btable,b);
+ return h->btable->count;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Looks for the breakpoint @var{number} in the table.
+
+  Return: The breakpoint or NULL. It belongs to the table.
+
+***************************************************************************/
+
+mi_bkpt *mi_get_bkpt_by_num(mi_h *h, int number)
+{
+ mi_bkpt_table *t=h->btable;
+
+ if (!t || number<=0 || number>=t->num_size || !t->num[number])
+    return NULL;
+ return t->num[number]->b;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Looks for a breakpoint at @var{addr}.
+
+  Return: The breakpoint or NULL. It belongs to the table.
+
+***************************************************************************/
+
+mi_bkpt *mi_get_bkpt_by_addr(mi_h *h, void *addr)
+{
+ mi_bkpt_table *t=h->btable;
+ mi_bkpt_node *n;
+
+ if (!t)
+    return NULL;
+ for (n=t->addr[mi_bkpt_hash_addr(t,addr)]; n; n=n->next_addr)
+     if (n->b->addr==addr)
+        return n->b;
+ return NULL;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Looks for a breakpoint at @var{file}:@var{line}. The file names are
+compared as gdb reports them, but a path matches its last components (i.e.
+"src/a.c" matches "/home/me/src/a.c").
+
+  Return: The breakpoint or NULL. It belongs to the table.
+
+***************************************************************************/
+
+mi_bkpt *mi_get_bkpt_by_line(mi_h *h, const char *file, int line)
+{
+ mi_bkpt_table *t=h->btable;
+ mi_bkpt_node *n;
+
+ if (!t || !file)
+    return NULL;
+ for (n=t->line[mi_bkpt_hash_line(t,file,line)]; n; n=n->next_line)
+     if (n->b->line==line && mi_bkpt_same_file(n->b->file,file))
+        return n->b;
+ return NULL;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Finds the breakpoint that stopped the program.
+
+  Return: The breakpoint or NULL if the stop wasn't caused by a known
+breakpoint. It belongs to the table.
+
+***************************************************************************/
+
+mi_bkpt *mi_get_stop_bkpt(mi_h *h, mi_stop *s)
+{
+ if (!s || !s->have_bkptno)
+    return NULL;
+ return mi_get_bkpt_by_num(h,s->bkptno);
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Number of breakpoints in the table.
+
+***************************************************************************/
+
+int mi_get_bkpt_count(mi_h *h)
+{
+ return h->btable ? h->btable->count : 0;
+}
@@ -35,13 +35,22 @@ gdb command:          Implemented?
 -break-watch          Yes
 @</pre>
 
-(*) I think the program should keep track of the breakpoints, so it will
-be implemented when I have more time.@p
+(*) The program should keep track of the breakpoints, the library can do
+it for you (see mi_set_bkpt_table).@p
+  Thousands of breakpoints can be inserted, deleted, enabled or disabled
+using the *_l functions, they send the commands without waiting for each
+answer.@p
 
 ***************************************************************************/
 
+#include <string.h>
 #include "mi_gdb.h"
 
+/* Commands sent before waiting for the first answer. */
+#define MI_BKPT_WINDOW 32
+/* Breakpoint numbers sent in each -break-delete/enable/disable. */
+#define MI_BKPT_CHUNK  256
+
 /* Low level versions. */
 
 void mi_break_insert_fl(mi_h *h, const char *file, int line)
@@ -138,6 +147,37 @@ void mi_break_list(mi_h *h)
     mi_send(h, "-break-list\n");
 }
 
+/* Pipelined versions, the answer is collected using the token. */
+
+static
+int mi_break_insert_tk(mi_h *h, int temporary, int hard_assist,
+                       const char *cond, const char *where)
+{
+ if (cond)
+    return mi_send_tk(h,"-break-insert %s %s -c \"%s\" %s\n",
+                      temporary   ? "-t" : "",
+                      hard_assist ? "-h" : "",
+                      cond,where);
+ return mi_send_tk(h,"-break-insert %s %s %s\n",
+                   temporary   ? "-t" : "",
+                   hard_assist ? "-h" : "",
+                   where);
+}
+
+/* Sends "cmd n1 n2 ...", count must be 1 to MI_BKPT_CHUNK. Without
+   numbers -break-delete kills all the breakpoints! */
+static
+int mi_break_numbers_tk(mi_h *h, const char *cmd, const int *numbers,
+                        int count)
+{
+ char buf[MI_BKPT_CHUNK*12+1];
+ int i, len=0;
+
+ for (i=0; i<count; i++)
+     len+=sprintf(buf+len," %d",numbers[i]);
+ return mi_send_tk(h,"%s%s\n",cmd,buf);
+}
+
 /* High level versions. */
 
 /**[txh]********************************************************************
@@ -153,14 +193,30 @@ error.
 
 mi_results *gmi_break_list(mi_h *h)
 {
+ mi_results *r;
+
  mi_break_list(h);
- return mi_res_done_var(h,"BreakpointTable");
+ r=mi_res_done_var(h,"BreakpointTable");
+ if (r && h->btable)
+    mi_bkpt_table_list(h,r);
+ return r;
+}
+
+/* Keeps the breakpoint table updated. */
+static
+mi_bkpt *mi_res_bkpt_table(mi_h *h)
+{
+ mi_bkpt *b=mi_res_bkpt(h);
+
+ if (b && h->btable)
+    mi_bkpt_table_add(h,b);
+ return b;
 }
 
 mi_bkpt *gmi_break_insert(mi_h *h, const char *file, int line)
 {
  mi_break_insert_fl(h,file,line);
- return mi_res_bkpt(h);
+ return mi_res_bkpt_table(h);
 }
 
 /**[txh]********************************************************************
@@ -179,7 +235,7 @@ mi_bkpt *gmi_break_insert_full(mi_h *h, int temporary, int hard_assist,
                                const char *where)
 {
  mi_break_insert(h,temporary,hard_assist,cond,count,thread,where);
- return mi_res_bkpt(h);
+ return mi_res_bkpt_table(h);
 }
 
 /**[txh]********************************************************************
@@ -198,7 +254,7 @@ mi_bkpt *gmi_break_insert_full_fl(mi_h *h, const char *file, int line,
                                   const char *cond, int count, int thread)
 {
  mi_break_insert_flf(h,file,line,temporary,hard_assist,cond,count,thread);
- return mi_res_bkpt(h);
+ return mi_res_bkpt_table(h);
 }
 
 /**[txh]********************************************************************
@@ -215,7 +271,10 @@ console.
 int gmi_break_delete(mi_h *h, int number)
 {
  mi_break_delete(h,number);
- return mi_res_simple_done(h);
+ if (!mi_res_simple_done(h))
+    return 0;
+ mi_bkpt_table_del(h,number);
+ return 1;
 }
 
 /**[txh]********************************************************************
@@ -231,8 +290,15 @@ console.
 
 int gmi_break_set_times(mi_h *h, int number, int count)
 {
+ mi_bkpt *b;
+
  mi_break_after(h,number,count);
- return mi_res_simple_done(h);
+ if (!mi_res_simple_done(h))
+    return 0;
+ b=mi_get_bkpt_by_num(h,number);
+ if (b)
+    b->ignore=count;
+ return 1;
 }
 
 /**[txh]********************************************************************
@@ -247,8 +313,18 @@ int gmi_break_set_times(mi_h *h, int number, int count)
 
 int gmi_break_set_condition(mi_h *h, int number, const char *condition)
 {
+ mi_bkpt *b;
+
  mi_break_condition(h,number,condition);
- return mi_res_simple_done(h);
+ if (!mi_res_simple_done(h))
+    return 0;
+ b=mi_get_bkpt_by_num(h,number);
+ if (b)
+   {
+    free(b->cond);
+    b->cond=condition && *condition ? strdup(condition) : NULL;
+   }
+ return 1;
 }
 
 /**[txh]********************************************************************
@@ -264,11 +340,213 @@ console.
 
 int gmi_break_state(mi_h *h, int number, int enable)
 {
+ mi_bkpt *b;
+
  if (enable)
     mi_break_enable(h,number);
  else
     mi_break_disable(h,number);
- return mi_res_simple_done(h);
+ if (!mi_res_simple_done(h))
+    return 0;
+ b=mi_get_bkpt_by_num(h,number);
+ if (b)
+    b->enabled=enable!=0;
+ return 1;
+}
+
+/* Fills @var{res} using the answer to -break-insert, releases @var{o}. Only
+   the fields we return are parsed, unless we keep the breakpoints table. */
+static
+int mi_res_bkpt_l(mi_h *h, mi_output *o, mi_bkpt_res *res)
+{
+ mi_output *rr=mi_get_rrecord(o);
+ mi_results *r=NULL, *c;
+ mi_bkpt *b;
+ char *end;
+
+ memset(res,0,sizeof(*res));
+ if (!rr)
+    res->error=mi_error!=MI_OK ? mi_error : MI_GDB_DIED;
+ else if (rr->tclass==MI_CL_ERROR)
+    res->error=MI_FROM_GDB;
+ else if (rr->tclass!=MI_CL_DONE)
+    res->error=MI_UNKNOWN_RESULT;
+ else
+   {
+    r=mi_get_var_r(rr->c,"bkpt");
+    if (!r || r->type!=t_tuple)
+       res->error=MI_PARSER;
+   }
+ if (res->error)
+   {
+    mi_free_output(o);
+    return 0;
+   }
+ if (h->btable)
+   {
+    b=mi_get_bkpt(r->v.rs);
+    if (b)
+      {
+       res->number=b->number;
+       res->addr=b->addr;
+       res->line=b->line;
+       mi_bkpt_table_add(h,b);
+       mi_free_bkpt(b);
+      }
+   }
+ else
+    for (c=r->v.rs; c; c=c->next)
+       {
+        if (c->type!=t_const)
+           continue;
+        if (c->atom==at_number)
+           res->number=atoi(c->v.cstr);
+        else if (c->atom==at_addr)
+           res->addr=(void *)strtoul(c->v.cstr,&end,0);
+        else if (c->atom==at_line)
+           res->line=atoi(c->v.cstr);
+       }
+ mi_free_output(o);
+ if (!res->number)
+   {
+    res->error=MI_PARSER;
+    return 0;
+   }
+ return 1;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Inserts @var{count} breakpoints, one for each location in @var{where}.
+@var{cond} can be NULL, otherwise it has a condition (or NULL) for each
+location. Many -break-insert commands are sent before waiting for the
+answers, so the round trip is paid once for each window and not for each
+breakpoint. The result for each location is stored in @var{res}, it must
+have room for @var{count} elements. Locations gdb refuses have number 0 and
+the error code. If gdb dies the rest of the locations get the error.
+
+  Command: -break-insert
+  Return: The number of breakpoints inserted.
+
+***************************************************************************/
+
+int gmi_break_insert_l(mi_h *h, int count, const char **where,
+                       const char **cond, int temporary, int hard_assist,
+                       mi_bkpt_res *res)
+{
+ int tk[MI_BKPT_WINDOW];
+ int sent=0, done=0, err=0, ok=0;
+
+ while (1)
+   {
+    /* Keep the window full. */
+    for (; !err && sent<count && sent-done<MI_BKPT_WINDOW; sent++)
+       {
+        tk[sent%MI_BKPT_WINDOW]=mi_break_insert_tk(h,temporary,hard_assist,
+                                                   cond ? cond[sent] : NULL,
+                                                   where[sent]);
+        if (!tk[sent%MI_BKPT_WINDOW])
+          {
+           err=1;
+           break;
+          }
+       }
+    if (done==sent)
+       break;
+    ok+=mi_res_bkpt_l(h,mi_get_response_tk(h,tk[done%MI_BKPT_WINDOW]),
+                      res+done);
+    done++;
+   }
+ for (; done<count; done++)
+    {
+     memset(res+done,0,sizeof(mi_bkpt_res));
+     res[done].error=mi_error!=MI_OK ? mi_error : MI_GDB_DIED;
+    }
+ return ok;
+}
+
+/* Sends cmd for all the numbers, in chunks. state is -1 for delete. */
+static
+int mi_break_numbers_l(mi_h *h, const char *cmd, const int *numbers,
+                       int count, int state)
+{
+ int tk[MI_BKPT_WINDOW];
+ int sent=0, done=0, err=0, n, i;
+ const int *nums;
+ mi_bkpt *b;
+
+ while (1)
+   {
+    /* Keep the window full. */
+    for (; !err && sent*MI_BKPT_CHUNK<count && sent-done<MI_BKPT_WINDOW;
+         sent++)
+       {
+        n=count-sent*MI_BKPT_CHUNK;
+        tk[sent%MI_BKPT_WINDOW]=
+          mi_break_numbers_tk(h,cmd,numbers+sent*MI_BKPT_CHUNK,
+                              n<MI_BKPT_CHUNK ? n : MI_BKPT_CHUNK);
+        if (!tk[sent%MI_BKPT_WINDOW])
+          {
+           err=1;
+           break;
+          }
+       }
+    if (done==sent)
+       break;
+    if (mi_res_simple_done_tk(h,tk[done%MI_BKPT_WINDOW]))
+      {/* Keep the table updated. */
+       nums=numbers+done*MI_BKPT_CHUNK;
+       n=count-done*MI_BKPT_CHUNK;
+       if (n>MI_BKPT_CHUNK)
+          n=MI_BKPT_CHUNK;
+       for (i=0; h->btable && i<n; i++)
+          {
+           if (state<0)
+              mi_bkpt_table_del(h,nums[i]);
+           else if ((b=mi_get_bkpt_by_num(h,nums[i]))!=NULL)
+              b->enabled=state;
+          }
+      }
+    else
+       err=1;
+    done++;
+   }
+ return !err;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Removes the @var{count} breakpoints listed in @var{numbers}. Up to
+MI_BKPT_CHUNK numbers are sent in each command and the commands are sent
+without waiting for each answer.
+
+  Command: -break-delete
+  Return: !=0 OK.
+
+***************************************************************************/
+
+int gmi_break_delete_l(mi_h *h, const int *numbers, int count)
+{
+ return mi_break_numbers_l(h,"-break-delete",numbers,count,-1);
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Enables or disables the @var{count} breakpoints listed in @var{numbers},
+like @x{gmi_break_delete_l} does.
+
+  Command: -break-enable + -break-disable
+  Return: !=0 OK.
+
+***************************************************************************/
+
+int gmi_break_state_l(mi_h *h, const int *numbers, int count, int enable)
+{
+ return mi_break_numbers_l(h,enable ? "-break-enable" : "-break-disable",
+                           numbers,count,enable!=0);
 }
 
 /**[txh]********************************************************************
@@ -39,12 +39,14 @@ in a row.
 #include <sys/wait.h>
 #include <fcntl.h>
 #include <string.h>
+#include <ctype.h>
 #include <stdarg.h>
 #include <limits.h>
 #include <errno.h>
 #include <signal.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <poll.h>
 #include "mi_gdb.h"
 
 #ifndef TEMP_FAILURE_RETRY
@@ -60,6 +62,8 @@ static char *gdb_conn=NULL;
 static char *main_func=NULL;
 static char  disable_psym_search_workaround=0;
 
+static void mi_cancel_pending(mi_h *h);
+
 mi_h *mi_alloc_h()
 {
  mi_h *h=(mi_h *)calloc(1,sizeof(mi_h));
@@ -109,6 +113,10 @@ void mi_kill_child(pid_t pid)
 void mi_free_h(mi_h **handle)
 {
  mi_h *h=*handle;
+ /* Don't leave a dangling session in the reactor, the descriptor must be
+    open to remove it. */
+ if (h->session)
+    mi_reactor_remove(h->session->reactor,h);
  if (h->to_gdb[0]>=0)
     close(h->to_gdb[0]);
  if (h->to)
@@ -125,9 +133,25 @@ void mi_free_h(mi_h **handle)
    {/* GDB is running! */
     mi_kill_child(h->pid);
    }
+ /* Nothing can be sent from now on. */
+ h->died=1;
  if (h->line)
     free(h->line);
+ free(h->echo);
+ free(h->rbuf);
  mi_free_output(h->po);
+ mi_cancel_pending(h);
+ mi_free_pending(h->pend);
+ mi_free_pending(h->ready);
+ mi_free_inc(h->inc);
+ mi_set_mem_cache(h,0);
+ mi_clear_tracked_memory(h);
+ mi_set_reg_cache(h,0,fm_natural);
+ free(h->reg_sizes);
+ mi_set_disasm_cache(h,0,NULL);
+ mi_set_bkpt_table(h,0);
+ mi_set_dprintf(h,0);
+ mi_set_auto_continue(h,0,NULL);
  free(h->catched_console);
  free(h);
  *handle=NULL;
@@ -141,36 +165,184 @@ void mi_set_nonblk(int h)
  fcntl(h,F_SETFL,flf);
 }
 
+/* Size of the buffer used to read from gdb. Big responses (memory dumps,
+   breakpoint lists, etc.) are read in chunks of this size. */
+#define MI_READ_BUF_SIZE 65536
+
+/* Makes room for at least need bytes in a line buffer. The size is doubled
+   so long lines don't need a realloc for each read. */
+static
+int mi_line_grow(char **line, int *llen, int need)
+{
+ int nlen;
+ char *nline;
+
+ if (need<=*llen)
+    return 1;
+ nlen=*llen ? *llen : 128;
+ while (nlen<need)
+    nlen*=2;
+ nline=(char *)realloc(*line,nlen);
+ if (!nline)
+   {
+    free(*line);
+    *line=NULL;
+    *llen=0;
+    return 0;
+   }
+ *line=nline;
+ *llen=nlen;
+ return 1;
+}
+
+/* Adds len bytes to a line buffer, \r characters are dropped. */
+static
+int mi_line_append(char **line, int *llen, int *lread, const char *s,
+                   int len)
+{
+ char *d;
+ const char *e;
+
+ if (!mi_line_grow(line,llen,*lread+len+1))
+   {
+    *lread=0;
+    return 0;
+   }
+ d=*line+*lread;
+ if (!memchr(s,'\r',len))
+   {
+    memcpy(d,s,len);
+    *lread+=len;
+    return 1;
+   }
+ for (e=s+len; s<e; s++)
+     if (*s!='\r')
+        *(d++)=*s;
+ *lread=d-*line;
+ return 1;
+}
+
+/* Reads as much as we can from gdb. Only called when the buffer is empty. */
+static
+int mi_fill_buffer(mi_h *h)
+{
+ int r;
+
+ if (!h->rbuf)
+   {
+    h->rbuf=mi_malloc(MI_READ_BUF_SIZE);
+    if (!h->rbuf)
+       return -1;
+    h->rsize=MI_READ_BUF_SIZE;
+   }
+ h->rpos=h->rend=0;
+ r=TEMP_FAILURE_RETRY(read(h->from_gdb[0],h->rbuf,h->rsize));
+ if (r>0)
+    h->rend=r;
+ else if (r==0)
+    /* End of file, gdb closed its side. */
+    h->died=1;
+ return r;
+}
+
+/* Appends what gdb has for us to the buffer, without consuming anything.
+   Used while a command is being written. */
+static
+int mi_stash_input(mi_h *h)
+{
+ int r;
+ char *n;
+
+ if (h->rpos>=h->rend)
+    return mi_fill_buffer(h);
+ if (h->rpos)
+   {
+    memmove(h->rbuf,h->rbuf+h->rpos,h->rend-h->rpos);
+    h->rend-=h->rpos;
+    h->rpos=0;
+   }
+ if (h->rend==h->rsize)
+   {
+    n=(char *)realloc(h->rbuf,h->rsize*2);
+    if (!n)
+      {
+       mi_error=MI_OUT_OF_MEMORY;
+       return -1;
+      }
+    h->rbuf=n;
+    h->rsize*=2;
+   }
+ r=TEMP_FAILURE_RETRY(read(h->from_gdb[0],h->rbuf+h->rend,h->rsize-h->rend));
+ if (r>0)
+    h->rend+=r;
+ else if (r==0)
+    h->died=1;
+ return r;
+}
+
 int mi_getline(mi_h *h)
 {
- char c;
+ char *s, *nl;
+ int len, ret;
 
- while (read(h->from_gdb[0],&c,1)==1)
+ do
    {
-    if (h->lread>=h->llen)
+    if (h->rpos<h->rend)
       {
-       h->llen=h->lread+128;
-       h->line=(char *)realloc(h->line,h->llen);
-       if (!h->line)
+       s=h->rbuf+h->rpos;
+       len=h->rend-h->rpos;
+       nl=(char *)memchr(s,'\n',len);
+       if (nl)
+          len=nl-s;
+       if (!mi_line_append(&h->line,&h->llen,&h->lread,s,len))
+          return -1;
+       if (nl)
          {
-          h->llen=0;
+          h->rpos+=len+1;
+          ret=h->lread;
+          h->line[ret]=0;
           h->lread=0;
-          return -1;
+          return ret;
          }
+       /* Incomplete line, keep it and ask for more. */
+       h->rpos=h->rend;
       }
-    if (c=='\n')
-      {
-       int ret=h->lread;
-       h->line[ret]=0;
-       h->lread=0;
-       return ret;
-      }
-    if (c!='\r')
+   }
+ while (mi_fill_buffer(h)>0);
+ return 0;
+}
+
+/* Feeds the incremental parser with what we have from gdb. Returns 1 when a
+   line is complete, the result is in h->inc and the text in h->echo. */
+static
+int mi_inc_getline(mi_h *h)
+{
+ int used, done;
+
+ do
+   {
+    if (h->rpos<h->rend)
       {
-       h->line[h->lread]=c;
-       h->lread++;
+       done=mi_inc_feed(h->inc,h->rbuf+h->rpos,h->rend-h->rpos,&used);
+       /* Only needed to echo it. Uses its own buffer, h->line could have
+          a partial line from mi_getline. */
+       if (h->from_gdb_echo &&
+           !mi_line_append(&h->echo,&h->elen,&h->eread,h->rbuf+h->rpos,
+                           done ? used-1 : used))
+          return -1;
+       h->rpos+=used;
+       if (done)
+         {
+          if (h->from_gdb_echo)
+            {
+             h->echo[h->eread]=0;
+             h->eread=0;
+            }
+          return 1;
+         }
       }
    }
+ while (mi_fill_buffer(h)>0);
  return 0;
 }
 
@@ -181,23 +353,126 @@ char *get_cstr(mi_output *o)
  return o->c->v.cstr;
 }
 
-int mi_get_response(mi_h *h)
+static
+mi_pending *mi_find_pending(mi_h *h, int token, mi_pending **prev)
+{
+ mi_pending *p, *pr=NULL;
+
+ /* gdb answers in order, so the first is the usual case. */
+ for (p=h->pend; p && p->token!=token; p=p->next)
+     pr=p;
+ if (prev)
+    *prev=pr;
+ return p;
+}
+
+static
+void mi_unlink_pending(mi_h *h, mi_pending *p, mi_pending *prev)
 {
- int l=mi_getline(h);
- if (!l)
+ if (prev)
+    prev->next=p->next;
+ else
+    h->pend=p->next;
+ if (h->pend_last==p)
+    h->pend_last=prev;
+}
+
+/* Called for result records with a token. */
+static
+int mi_set_pending(mi_h *h, mi_output *o, int is_exit)
+{
+ mi_pending *prev, *p=mi_find_pending(h,o->token,&prev);
+
+ if (!p || p->o)
     return 0;
+ p->o=o;
+ h->in_flight--;
+ /* The prompt that follows isn't for the current response. */
+ if (!is_exit)
+    h->skip_prompts++;
+ if (p->cb)
+   {/* mi_submit, the callback owns the answer and could send more
+       commands. */
+    mi_unlink_pending(h,p,prev);
+    p->cb(o,p->cb_data);
+    free(p);
+   }
+ return 1;
+}
+
+/* Tells all the completions that no answer will come. */
+static
+void mi_cancel_pending(mi_h *h)
+{
+ mi_pending *p=h->pend, *prev=NULL, *next;
 
- if (h->from_gdb_echo)
-    h->from_gdb_echo(h->line,h->from_gdb_echo_data);
- if (strncmp(h->line,"(gdb)",5)==0)
+ while (p)
+   {
+    next=p->next;
+    if (p->cb)
+      {
+       mi_unlink_pending(h,p,prev);
+       p->cb(NULL,p->cb_data);
+       free(p);
+      }
+    else
+       prev=p;
+    p=next;
+   }
+}
+
+/* Reads one line from gdb. Returns 1 when the regular response in h->po is
+   complete. */
+static
+int mi_read_response(mi_h *h)
+{
+ int l, prompt;
+ mi_output *o=NULL;
+
+ /* The event parser needs complete lines, we switch between lines. A line
+    started by one of the parsers must be finished by the same parser. */
+ if (h->inc && (h->inc->in_line || (!h->lread && !h->event)))
+   {
+    if (mi_inc_getline(h)<=0)
+       return 0;
+    if (h->from_gdb_echo)
+       h->from_gdb_echo(h->echo,h->from_gdb_echo_data);
+    prompt=h->inc->prompt;
+    o=h->inc->o;
+    h->inc->o=NULL;
+    if (!prompt && !o)
+       return 0;
+   }
+ else
+   {
+    l=mi_getline(h);
+    if (l<=0)
+       return 0;
+    if (h->from_gdb_echo)
+       h->from_gdb_echo(h->line,h->from_gdb_echo_data);
+    prompt=strncmp(h->line,"(gdb)",5)==0;
+   }
+ if (prompt)
    {/* End of response. */
+    if (h->skip_prompts)
+      {
+       h->skip_prompts--;
+       return 0;
+      }
     return 1;
    }
  else
    {/* Add to the response. */
-    mi_output *o;
     int add=1, is_exit=0;
-    o=mi_parse_gdb_output(h->line);
+    if (o)
+      {/* Already parsed by the incremental parser. */
+      }
+    else if (h->event && !isdigit((unsigned char)h->line[0]))
+       o=mi_parse_gdb_output_ev(h->line,h->event,h->event_data);
+    else if (h->use_arena)
+       o=mi_parse_gdb_output_arena(h->line);
+    else
+       o=mi_parse_gdb_output(h->line);
 
     if (!o)
        return 0;
@@ -210,6 +485,9 @@ int mi_get_response(mi_h *h)
          {
           case MI_SST_CONSOLE:
                aux=get_cstr(o);
+               /* The output of our dprintf probes isn't for the console. */
+               if (h->dprintf && aux && !(aux=mi_dprintf_stream(h,aux)))
+                  break;
                if (h->console)
                   h->console(aux,h->console_data);
                if (h->catch_console && aux)
@@ -224,8 +502,11 @@ int mi_get_response(mi_h *h)
                break;
           case MI_SST_TARGET:
                /* This one seems to be useless. */
+               aux=get_cstr(o);
+               if (h->dprintf && aux && !(aux=mi_dprintf_stream(h,aux)))
+                  break;
                if (h->target)
-                  h->target(get_cstr(o),h->target_data);
+                  h->target(aux,h->target_data);
                break;
           case MI_SST_LOG:
                if (h->log)
@@ -235,7 +516,11 @@ int mi_get_response(mi_h *h)
       }
     else if (o->type==MI_T_OUT_OF_BAND && o->stype==MI_ST_ASYNC)
       {
-       if (h->async)
+       mi_bkpt_table_notify(h,o);
+       if ((h->dprintf && mi_dprintf_notify(o)) ||
+           (h->autocont && mi_autocont_notify(h,o)))
+          add=0;
+       else if (h->async)
           h->async(o,h->async_data);
       }
     else if (o->type==MI_T_RESULT_RECORD && o->tclass==MI_CL_ERROR)
@@ -246,9 +531,22 @@ int mi_get_response(mi_h *h)
        if (o->c && strcmp(o->c->var,"msg")==0 && o->c->type==t_const)
           mi_error_from_gdb=strdup(o->c->v.cstr);
       }
+    /* ^running or *running, the memory and registers we know are no longer
+       valid. */
+    if (o->tclass==MI_CL_RUNNING &&
+        (o->type==MI_T_RESULT_RECORD || o->stype==MI_ST_ASYNC))
+      {
+       mi_mem_cache_invalidate(h);
+       if (h->rcache)
+          h->rcache->stale=1;
+      }
     is_exit=(o->type==MI_T_RESULT_RECORD && o->tclass==MI_CL_EXIT);
+    if (o->token && o->type==MI_T_RESULT_RECORD &&
+        mi_set_pending(h,o,is_exit))
+      {/* Answer for mi_send_tk or mi_submit. */
+      }
     /* Add to the list of responses. */
-    if (add)
+    else if (add)
       {
        if (h->last)
           h->last->next=o;
@@ -266,16 +564,115 @@ int mi_get_response(mi_h *h)
  return 0;
 }
 
+int mi_get_response(mi_h *h)
+{
+ int ret;
+
+ /* Commands we couldn't send while reading, i.e. waiting for a token. */
+ if (h->autocont)
+    mi_autocont_flush(h);
+ /* mi_process_input or a wait for a token already found it. */
+ if (h->resp_ready || h->ready)
+    return 1;
+ ret=mi_read_response(h);
+ /* Don't wait for gdb with the inferior stopped by us. */
+ if (h->autocont)
+    mi_autocont_flush(h);
+ return ret;
+}
+
+/* Used while we wait for a token. A regular response (i.e. *stopped and its
+   prompt) that gets complete is moved to h->ready, so the records that
+   follow don't get mixed with it. */
+static
+void mi_read_response_tk(mi_h *h)
+{
+ mi_pending *p;
+
+ if (!h->resp_ready && !mi_read_response(h))
+    return;
+ h->resp_ready=0;
+ p=(mi_pending *)mi_calloc1(sizeof(mi_pending));
+ if (!p)
+   {/* Better mixed than lost. */
+    h->resp_ready=1;
+    return;
+   }
+ p->o=h->po;
+ h->po=h->last=NULL;
+ if (h->ready_last)
+    h->ready_last->next=p;
+ else
+    h->ready=p;
+ h->ready_last=p;
+}
+
 mi_output *mi_retire_response(mi_h *h)
 {
- mi_output *ret=h->po;
+ mi_output *ret;
+ mi_pending *p=h->ready;
+
+ if (p)
+   {/* Completed while we waited for a token, they go first. */
+    ret=p->o;
+    h->ready=p->next;
+    if (!h->ready)
+       h->ready_last=NULL;
+    free(p);
+    return ret;
+   }
+ ret=h->po;
  h->po=h->last=NULL;
+ h->resp_ready=0;
  return ret;
 }
 
+/* Waits until gdb sends something. Returns 0 if gdb died or we got a time
+   out. */
+static
+int mi_wait_input(mi_h *h)
+{
+ /*
+  That's a must. If we just keep trying to read and failing things
+  become really sloooowwww. Instead we try and if it fails we wait
+  until something is available.
+ */
+ struct pollfd pf;
+ int ret;
+
+ /* Lines already in our buffer won't wake up poll. */
+ if (h->rpos<h->rend)
+    return 1;
+ if (h->died)
+   {
+    mi_error=MI_GDB_DIED;
+    return 0;
+   }
+ /* Note: select can't handle descriptors over FD_SETSIZE, poll can. */
+ pf.fd=h->from_gdb[0];
+ pf.events=POLLIN;
+ ret=TEMP_FAILURE_RETRY(poll(&pf,1,h->time_out*1000));
+ if (!ret)
+   {
+    if (!mi_check_running(h))
+      {
+       h->died=1;
+       mi_error=MI_GDB_DIED;
+       return 0;
+      }
+    if (h->time_out_cb)
+       ret=h->time_out_cb(h->time_out_cb_data);
+    if (!ret)
+      {
+       mi_error=MI_GDB_TIME_OUT;
+       return 0;
+      }
+   }
+ return 1;
+}
+
 mi_output *mi_get_response_blk(mi_h *h)
 {
- int r;
  /* Sometimes gdb dies. */
  if (!mi_check_running(h))
    {
@@ -285,59 +682,70 @@ mi_output *mi_get_response_blk(mi_h *h)
    }
  do
    {
-    if (1)
-      {
-       /*
-        That's a must. If we just keep trying to read and failing things
-        become really sloooowwww. Instead we try and if it fails we wait
-        until something is available.
-        TODO: Implement something with the time out, a callback to ask the
-        application is we have to wait or not could be a good thing.
-       */
-       fd_set set;
-       struct timeval timeout;
-       int ret;
-
-       r=mi_get_response(h);
-       if (r)
-          return mi_retire_response(h);
-
-       FD_ZERO(&set);
-       FD_SET(h->from_gdb[0],&set);
-       timeout.tv_sec=h->time_out;
-       timeout.tv_usec=0;
-       ret=TEMP_FAILURE_RETRY(select(FD_SETSIZE,&set,NULL,NULL,&timeout));
-       if (!ret)
-         {
-          if (!mi_check_running(h))
-            {
-             h->died=1;
-             mi_error=MI_GDB_DIED;
-             return NULL;
-            }
-          if (h->time_out_cb)
-             ret=h->time_out_cb(h->time_out_cb_data);
-          if (!ret)
-            {
-             mi_error=MI_GDB_TIME_OUT;
-             return NULL;
-            }
-         }
-      }
-    else
-      {
-       r=mi_get_response(h);
-       if (r)
-          return mi_retire_response(h);
-       else
-          usleep(100);
-      }
+    if (mi_get_response(h))
+       return mi_retire_response(h);
    }
- while (!r);
+ while (mi_wait_input(h));
 
  return NULL;
 }
 
+/**[txh]********************************************************************
+
+  Description:
+  Gets the answer for a command sent using @x{mi_send_tk}. It doesn't wait,
+use @x{mi_get_response_tk} for it. Note that you must call
+@x{mi_get_response} (or any function that waits for gdb) to read gdb output.
+
+  Return: The output for this command or NULL if not yet available.
+
+***************************************************************************/
+
+mi_output *mi_retire_response_tk(mi_h *h, int token)
+{
+ mi_pending *prev, *p=mi_find_pending(h,token,&prev);
+ mi_output *o;
+
+ if (!p || !p->o)
+    return NULL;
+ mi_unlink_pending(h,p,prev);
+ o=p->o;
+ free(p);
+ return o;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Waits until gdb answers the command sent using @x{mi_send_tk}. Commands
+with a token can be answered in any order, so you can send many of them and
+then collect the results.
+
+  Return: The output for this command (the result record) or NULL on error.
+
+***************************************************************************/
+
+mi_output *mi_get_response_tk(mi_h *h, int token)
+{
+ mi_pending *p=mi_find_pending(h,token,NULL);
+
+ if (!p)
+    return NULL;
+ if (!p->o && !mi_check_running(h))
+   {
+    h->died=1;
+    mi_error=MI_GDB_DIED;
+    return NULL;
+   }
+ while (!p->o)
+   {
+    mi_read_response_tk(h);
+    if (!p->o && !mi_wait_input(h))
+       return NULL;
+   }
+ return mi_retire_response_tk(h,token);
+}
+
 void mi_send_commands(mi_h *h, const char *file)
 {
  FILE *f;
@@ -437,6 +845,10 @@ mi_h *mi_connect_local()
     mi_free_h(&h);
     return NULL;
    }
+ /* The child's ends, so we get an end of file if gdb dies. */
+ close(h->to_gdb[0]);
+ close(h->from_gdb[1]);
+ h->to_gdb[0]=h->from_gdb[1]=-1;
  if (!mi_check_running(h))
    {
     mi_error=MI_DEBUGGER_RUN;
@@ -517,6 +929,29 @@ async_cb mi_get_async_cb(mi_h *h, void **data)
  return h->async;
 }
 
+/**[txh]********************************************************************
+
+  Description:
+  While set, the results of the ^done records are reported to @var{cb} as
+events (see mi_parse_gdb_output_ev) and the records in the response have no
+content. Answers to commands sent with a token aren't affected. Use NULL to
+go back to trees.
+  
+***************************************************************************/
+
+void mi_set_event_cb(mi_h *h, event_cb cb, void *data)
+{
+ h->event=cb;
+ h->event_data=data;
+}
+
+event_cb mi_get_event_cb(mi_h *h, void **data)
+{
+ if (data)
+    *data=h->event_data;
+ return h->event;
+}
+
 void mi_set_to_gdb_cb(mi_h *h, stream_cb cb, void *data)
 {
  h->to_gdb_echo=cb;
@@ -566,6 +1001,62 @@ int mi_get_time_out(mi_h *h)
  return h->time_out;
 }
 
+/**[txh]********************************************************************
+
+  Description:
+  Enables or disables the use of arenas to parse the records from gdb (see
+mi_parse_gdb_output_arena). Big responses are parsed and released faster.
+Only the records parsed after the call are affected.
+  
+***************************************************************************/
+
+void mi_set_arena(mi_h *h, int enable)
+{
+ h->use_arena=enable!=0;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Enables or disables the incremental parser. When enabled the records are
+parsed while the bytes arrive from gdb (see mi_inc_feed), we don't wait for
+the whole line and then scan it again. It overlaps parsing with gdb output.
+Arenas aren't used in this mode. The mode can't be disabled in the middle
+of a line.
+  
+  Return: !=0 OK.
+  
+***************************************************************************/
+
+int mi_set_incremental(mi_h *h, int enable)
+{
+ if (enable)
+   {
+    if (!h->inc)
+       h->inc=mi_alloc_inc();
+    return h->inc!=NULL;
+   }
+ if (h->inc && h->inc->in_line)
+    return 0;
+ mi_free_inc(h->inc);
+ h->inc=NULL;
+ return 1;
+}
+
+/* How CLI commands are sent using MI. */
+#define MI_CONSOLE_PREFIX "-interpreter-exec console \""
+
+/* Used by the hooks that look at the commands we send. Skips the token and,
+   for CLI commands sent to the console interpreter, the MI wrapper. */
+const char *mi_cmd_name(const char *cmd)
+{
+ while (isdigit((unsigned char)*cmd))
+    cmd++;
+ if (strncmp(cmd,MI_CONSOLE_PREFIX,sizeof(MI_CONSOLE_PREFIX)-1)==0)
+    cmd+=sizeof(MI_CONSOLE_PREFIX)-1;
+ return cmd;
+}
+
 int mi_send(mi_h *h, const char *format, ...)
 {
  int ret;
@@ -578,6 +1069,9 @@ int mi_send(mi_h *h, const char *format, ...)
  va_start(argptr,format);
  ret=vasprintf(&str,format,argptr);
  va_end(argptr);
+ mi_mem_cache_cmd(h,str);
+ mi_reg_cache_cmd(h,str);
+ mi_disasm_cache_cmd(h,str);
  fputs(str,h->to);
  fflush(h->to);
  if (h->to_gdb_echo)
@@ -587,6 +1081,231 @@ int mi_send(mi_h *h, const char *format, ...)
  return ret;
 }
 
+/* Max. number of commands sent with a token that can wait for an answer.
+   If we send too much without reading gdb could block writing its output
+   and then we would block writing the commands. */
+#define MI_MAX_IN_FLIGHT 32
+
+/* Writes the whole string. As the pipe is non-blocking we could find it
+   full, in this case we read gdb output while waiting. */
+static
+int mi_write_all(mi_h *h, const char *s, int len)
+{
+ int w, r;
+ struct pollfd pf[2];
+
+ while (len>0)
+   {
+    w=TEMP_FAILURE_RETRY(write(h->to_gdb[1],s,len));
+    if (w>0)
+      {
+       s+=w;
+       len-=w;
+       continue;
+      }
+    if (w<0 && errno!=EAGAIN && errno!=EWOULDBLOCK)
+       break;
+    /* Don't process the answers here: callbacks could send commands and
+       they would be mixed with the half written one. Just keep the data. */
+    pf[0].fd=h->to_gdb[1];
+    pf[0].events=POLLOUT;
+    pf[1].fd=h->from_gdb[0];
+    pf[1].events=POLLIN;
+    if (TEMP_FAILURE_RETRY(poll(pf,2,h->time_out*1000))<=0)
+      {
+       mi_error=MI_GDB_TIME_OUT;
+       break;
+      }
+    if (pf[1].revents & (POLLIN | POLLHUP))
+      {
+       r=mi_stash_input(h);
+       if (r==0 || (r<0 && errno!=EAGAIN && errno!=EWOULDBLOCK))
+          break;
+      }
+   }
+ if (len>0)
+   {
+    /* gdb got part of a command, we can't talk to it anymore. */
+    h->died=1;
+    return 0;
+   }
+ return 1;
+}
+
+static
+int mi_vsend_tk(mi_h *h, done_cb cb, void *data, const char *format,
+                va_list argptr)
+{
+ char *cmd, *str;
+ int len, token;
+ mi_pending *p;
+
+ if (h->died)
+    return 0;
+ /* Don't let gdb block, collect some answers first. */
+ while (h->in_flight>=MI_MAX_IN_FLIGHT)
+   {
+    mi_read_response_tk(h);
+    if (h->in_flight>=MI_MAX_IN_FLIGHT && !mi_wait_input(h))
+       return 0;
+   }
+ p=(mi_pending *)mi_calloc1(sizeof(mi_pending));
+ if (!p)
+    return 0;
+ token=h->last_token==INT_MAX ? 1 : h->last_token+1;
+ h->last_token=p->token=token;
+ p->cb=cb;
+ p->cb_data=data;
+
+ len=vasprintf(&cmd,format,argptr);
+ if (len<0)
+   {
+    free(p);
+    mi_error=MI_OUT_OF_MEMORY;
+    return 0;
+   }
+ mi_mem_cache_cmd(h,cmd);
+ mi_reg_cache_cmd(h,cmd);
+ mi_disasm_cache_cmd(h,cmd);
+ len=asprintf(&str,"%d%s",token,cmd);
+ free(cmd);
+ if (len<0)
+   {
+    free(p);
+    mi_error=MI_OUT_OF_MEMORY;
+    return 0;
+   }
+ /* Link it before writing, the answer can arrive as soon as gdb gets the
+    command. */
+ if (h->pend_last)
+    h->pend_last->next=p;
+ else
+    h->pend=p;
+ h->pend_last=p;
+ h->in_flight++;
+ fflush(h->to);
+ if (!mi_write_all(h,str,len))
+   {
+    mi_pending *prev;
+    if (mi_find_pending(h,token,&prev)==p)
+      {
+       mi_unlink_pending(h,p,prev);
+       h->in_flight--;
+       free(p);
+      }
+    free(str);
+    return 0;
+   }
+ if (h->to_gdb_echo)
+    h->to_gdb_echo(str,h->to_gdb_echo_data);
+ free(str);
+
+ return token;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Sends a command prefixed with a new token. The answer is collected using
+@x{mi_get_response_tk} or @x{mi_retire_response_tk}. Many commands can be
+sent before asking for the answers, the round trip is paid only once.
+Don't use the regular @x{mi_get_response_blk} to get these answers.
+
+  Return: The token or 0 on error.
+
+***************************************************************************/
+
+int mi_send_tk(mi_h *h, const char *format, ...)
+{
+ int ret;
+ va_list argptr;
+
+ va_start(argptr,format);
+ ret=mi_vsend_tk(h,NULL,NULL,format,argptr);
+ va_end(argptr);
+ return ret;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Like @x{mi_submit}, but the command is a printf format and must include
+the newline.
+
+  Return: The token used for the command or 0 on error.
+
+***************************************************************************/
+
+static
+int mi_send_cb(mi_h *h, done_cb cb, void *data, const char *format, ...)
+{
+ int ret;
+ va_list argptr;
+
+ va_start(argptr,format);
+ ret=mi_vsend_tk(h,cb,data,format,argptr);
+ va_end(argptr);
+ return ret;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Sends a command and returns without waiting. When gdb answers @var{cb} is
+called with the result record, the callback owns it and must release it
+using mi_free_output. If gdb dies, or the connection is closed, the callback
+is called with NULL. The answers are read by @x{mi_process_input} and by any
+function that waits for gdb. The callback can send more commands.
+
+  Return: The token used for the command or 0 on error.
+
+***************************************************************************/
+
+int mi_submit(mi_h *h, const char *cmd, done_cb cb, void *data)
+{
+ int l=strlen(cmd);
+ return mi_send_cb(h,cb,data,l && cmd[l-1]=='\n' ? "%s" : "%s\n",cmd);
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Reads all the complete lines gdb sent and calls the completions for the
+commands sent using @x{mi_submit}. It doesn't wait, so you can call it when
+the gdb output (MI_FROM) is readable. It stops when a regular response
+(i.e. an async stop) is complete, get it using @x{mi_retire_response}.
+
+  Return: >0 if a regular response is complete, 0 if not and <0 if gdb died.
+
+***************************************************************************/
+
+int mi_process_input(mi_h *h)
+{
+ /* mi_get_response sends the commands we couldn't send while reading, but
+    only if it gets called. */
+ if (h->autocont)
+    mi_autocont_flush(h);
+ /* Completed while we waited for a token. */
+ if (h->ready)
+    return 1;
+ do
+   {
+    if (mi_get_response(h))
+      {
+       h->resp_ready=1;
+       return 1;
+      }
+   }
+ while (h->rpos<h->rend);
+ if (h->died)
+   {
+    mi_cancel_pending(h);
+    mi_error=MI_GDB_DIED;
+    return -1;
+   }
+ return 0;
+}
+
 void mi_clean_up_globals()
 {
  free(gdb_exe);
@@ -402,7 +402,8 @@ int MIDebugger::Stop()
 "stopped" messages. You must call it when the state is "running". But the
 function will poll gdb even if the state isn't "running". When a stopped
 message is received the state changes to stopped or target_specified (the
-last is when we get some exit).
+last is when we get some exit). At each stop the memory registered using
+@x{::TrackMemory} is compared with the previous stop.
   
   Return: !=0 if we got a response. The @var{rs} pointer will point to an
 mi_stop structure if we got it or will be NULL if we didn't.
@@ -983,6 +984,41 @@ int MIDebugger::Send(const char *command)
  return mi_res_simple_done(h);
 }
 
+#if __cplusplus>=201103L
+static
+void FutureDone(mi_output *o, void *data)
+{
+ std::promise<mi_output *> *p=(std::promise<mi_output *> *)data;
+ p->set_value(o);
+ delete p;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Sends a command to gdb without waiting for the answer. The future gets
+the result record (use mi_free_output to release it) or NULL on error. Note
+that the answer is read by @x{::ProcessInput}, @x{::Poll} or any member that
+waits for gdb. So don't block waiting for the future, check it after
+calling ProcessInput.
+  
+  Return: A future for the answer.
+  
+***************************************************************************/
+
+std::future<mi_output *> MIDebugger::SubmitFuture(const char *command)
+{
+ std::promise<mi_output *> *p=new std::promise<mi_output *>;
+ std::future<mi_output *> f=p->get_future();
+
+ if (state==disconnected || !mi_submit(h,command,FutureDone,p))
+   {
+    p->set_value(NULL);
+    delete p;
+   }
+ return f;
+}
+#endif
 
 /**[txh]********************************************************************
 
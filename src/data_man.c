@@ -30,6 +30,8 @@ gdb command:                       Implemented?
 -data-list-register-names          Yes
 -data-list-register-values         No
 -data-read-memory                  No
+-data-read-memory-bytes            Yes
+-data-write-memory-bytes           Yes
 -display-delete                    N.A. (delete display)
 -display-disable                   N.A. (disable display)
 -display-enable                    N.A. (enable display)
@@ -86,8 +88,18 @@ Fixed by Changelog entry:
 
 ***************************************************************************/
 
+#include <string.h>
 #include "mi_gdb.h"
 
+/* Big reads are split in chunks of this size, and this number of chunks is
+   requested before waiting for the first answer. */
+#define MI_READ_MEM_CHUNK  65536
+#define MI_READ_MEM_WINDOW 8
+/* The same for writes, the command carries two hex digits per byte. */
+#define MI_WRITE_MEM_CHUNK 32768
+/* Block scanned at once when we search the memory ourselves. */
+#define MI_FIND_CHUNK      (1<<20)
+
 /* Low level versions. */
 
 void mi_data_evaluate_expression(mi_h *h, const char *expression)
@@ -119,6 +131,22 @@ void mi_data_read_memory_hx(mi_h *h, const char *exp, unsigned ws,
     mi_send(h,"-data-read-memory \"%s\" x %d 1 %d\n",exp,ws,c);
 }
 
+int mi_data_read_memory_bytes_tk(mi_h *h, unsigned long addr,
+                                 unsigned long size)
+{
+ return mi_send_tk(h,"-data-read-memory-bytes 0x%lx %lu\n",addr,size);
+}
+
+/* hex is a buffer for at least 2*len+1 chars. */
+int mi_data_write_memory_bytes_tk(mi_h *h, unsigned long addr,
+                                  const unsigned char *buf, unsigned long len,
+                                  char *hex)
+{
+ mi_hex_encode(hex,buf,len);
+ hex[2*len]=0;
+ return mi_send_tk(h,"-data-write-memory-bytes 0x%lx %s\n",addr,hex);
+}
+
 void mi_data_disassemble_se(mi_h *h, const char *start, const char *end,
                             int mode)
 {
@@ -203,13 +231,401 @@ int gmi_read_memory(mi_h *h, const char *exp, unsigned size,
                     unsigned char *dest, int *na, int convAddr,
                     unsigned long *addr)
 {
+ unsigned long a;
+ char *end;
+ mi_mem_region *reg=NULL;
+ long r;
+
+ if (h->mcache && !convAddr)
+   {/* Plain addresses can be served from the cache. */
+    a=strtoul(exp,&end,0);
+    if (*exp && !*end)
+      {
+       r=mi_mem_cache_read(h,a,size,dest,&reg);
+       /* Not all readable unless the first region covers the whole block. */
+       *na=!reg || reg->start!=a || reg->end-reg->start<size;
+       if (addr)
+          *addr=a;
+       mi_free_mem_region(reg);
+       return r>=0;
+      }
+   }
  mi_data_read_memory_hx(h,exp,1,size,convAddr);
  return mi_get_read_memory(h,dest,1,na,addr);
 }
 
+/**[txh]********************************************************************
+
+  Description:
+  Reads @var{size} bytes starting at @var{addr} to @var{dest}. The hex blob
+sent by gdb is decoded directly to @var{dest}. Big blocks are requested in
+chunks, many chunks are requested before waiting for the answers, so the
+transfer isn't limited by the round trip. When the memory cache is enabled
+(see mi_set_mem_cache) the pages already known aren't requested.@p
+  Unreadable parts aren't an error, they are just left untouched in
+@var{dest}. The readable ranges are returned in @var{regions} (if not
+NULL), release them using mi_free_mem_region.
+
+  Command: -data-read-memory-bytes
+  Return: The number of bytes read or -1 on error.
+
+***************************************************************************/
+
+long gmi_read_memory_bytes(mi_h *h, unsigned long addr, unsigned long size,
+                           unsigned char *dest, mi_mem_region **regions)
+{
+ if (h->mcache)
+    return mi_mem_cache_read(h,addr,size,dest,regions);
+ return mi_read_memory_bytes(h,addr,size,dest,regions);
+}
+
+/* gmi_read_memory_bytes without the cache. */
+long mi_read_memory_bytes(mi_h *h, unsigned long addr, unsigned long size,
+                          unsigned char *dest, mi_mem_region **regions)
+{
+ int tk[MI_READ_MEM_WINDOW];
+ unsigned long nchunks=(size+MI_READ_MEM_CHUNK-1)/MI_READ_MEM_CHUNK;
+ unsigned long sent=0, i, off, len;
+ long total=0, r=0;
+ mi_output *o;
+
+ if (regions)
+    *regions=NULL;
+ for (i=0; i<nchunks; i++)
+    {
+     /* Keep the window full. */
+     for (; sent<nchunks && sent-i<MI_READ_MEM_WINDOW; sent++)
+        {
+         off=sent*MI_READ_MEM_CHUNK;
+         len=size-off<MI_READ_MEM_CHUNK ? size-off : MI_READ_MEM_CHUNK;
+         tk[sent%MI_READ_MEM_WINDOW]=
+           mi_data_read_memory_bytes_tk(h,addr+off,len);
+         if (!tk[sent%MI_READ_MEM_WINDOW])
+            break;
+        }
+     if (i==sent)
+       {
+        r=-1;
+        break;
+       }
+     off=i*MI_READ_MEM_CHUNK;
+     len=size-off<MI_READ_MEM_CHUNK ? size-off : MI_READ_MEM_CHUNK;
+     o=mi_get_response_tk(h,tk[i%MI_READ_MEM_WINDOW]);
+     r=o ? mi_get_read_memory_bytes(o,addr+off,len,dest+off,regions) : -1;
+     mi_free_output(o);
+     if (r<0)
+       {
+        i++;
+        break;
+       }
+     total+=r;
+    }
+ if (r<0)
+   {/* Error, collect the answers we are waiting for. */
+    for (; i<sent; i++)
+        mi_free_output(mi_get_response_tk(h,tk[i%MI_READ_MEM_WINDOW]));
+    if (regions)
+      {
+       mi_free_mem_region(*regions);
+       *regions=NULL;
+      }
+    return -1;
+   }
+ return total;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Writes the blocks listed in @var{l} to the target memory. Big blocks are
+split in chunks and many chunks are sent before waiting for the answers, as
+gmi_read_memory_bytes does. After an error no more chunks are sent.
+
+  Command: -data-write-memory-bytes
+  Return: The number of bytes written or -1 on error.
+
+***************************************************************************/
+
+long gmi_write_memory_l(mi_h *h, mi_mem_write *l)
+{
+ int tk[MI_READ_MEM_WINDOW];
+ unsigned long lens[MI_READ_MEM_WINDOW];
+ unsigned long off=0, len;
+ int sent=0, done=0, err=0;
+ long total=0;
+ mi_output *o;
+ char *hex=mi_malloc(2*MI_WRITE_MEM_CHUNK+1);
+
+ if (!hex)
+    return -1;
+ while (1)
+   {
+    /* Keep the window full. */
+    while (!err && l && sent-done<MI_READ_MEM_WINDOW)
+      {
+       len=l->len-off<MI_WRITE_MEM_CHUNK ? l->len-off : MI_WRITE_MEM_CHUNK;
+       if (len)
+         {
+          tk[sent%MI_READ_MEM_WINDOW]=
+            mi_data_write_memory_bytes_tk(h,l->addr+off,l->buf+off,len,hex);
+          if (!tk[sent%MI_READ_MEM_WINDOW])
+            {
+             err=1;
+             break;
+            }
+          lens[sent%MI_READ_MEM_WINDOW]=len;
+          sent++;
+         }
+       off+=len;
+       if (off>=l->len)
+         {
+          l=l->next;
+          off=0;
+         }
+      }
+    if (done==sent)
+       break;
+    o=mi_get_response_tk(h,tk[done%MI_READ_MEM_WINDOW]);
+    if (o && o->tclass==MI_CL_DONE)
+       total+=lens[done%MI_READ_MEM_WINDOW];
+    else
+       err=1;
+    mi_free_output(o);
+    done++;
+   }
+ free(hex);
+ return err ? -1 : total;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Writes @var{len} bytes from @var{buf} to the target memory at @var{addr}.
+See @x{gmi_write_memory_l}.
+
+  Command: -data-write-memory-bytes
+  Return: The number of bytes written or -1 on error.
+
+***************************************************************************/
+
+long gmi_write_memory(mi_h *h, unsigned long addr, const unsigned char *buf,
+                      unsigned long len)
+{
+ mi_mem_write w;
+
+ w.addr=addr;
+ w.buf=buf;
+ w.len=len;
+ w.next=NULL;
+ return gmi_write_memory_l(h,&w);
+}
+
+/* Collects the addresses printed by the CLI find command. */
+typedef struct
+{
+ unsigned long *matches;
+ long max, count;
+ /* gdb stopped at memory it can't read. */
+ int halted;
+ stream_cb log;
+ void *log_data;
+} mi_find_st;
+
+static
+void mi_find_cb(const char *str, void *data)
+{
+ mi_find_st *s=(mi_find_st *)data;
+ char *end;
+
+ if (strncmp(str,"0x",2)==0 && s->count<s->max)
+    s->matches[s->count++]=strtoul(str,&end,16);
+}
+
+/* find stops at the first byte it can't read, it's just a warning and the
+   answer is ^done. */
+static
+void mi_find_log_cb(const char *str, void *data)
+{
+ mi_find_st *s=(mi_find_st *)data;
+
+ if (strstr(str,"halting search"))
+    s->halted=1;
+ else if (s->log)
+    s->log(str,s->log_data);
+}
+
+/* Uses the find command, gdb reads the memory. */
+static
+long mi_find_memory_gdb(mi_h *h, unsigned long start, unsigned long len,
+                        const unsigned char *pat, size_t plen,
+                        unsigned long *matches, long max)
+{
+ mi_find_st st;
+ stream_cb old;
+ void *old_data;
+ char *bytes=mi_malloc(plen*6+1), *s=bytes;
+ size_t i;
+ int ok;
+
+ if (!bytes)
+    return -1;
+ for (i=0; i<plen; i++)
+     s+=sprintf(s,", 0x%02x",pat[i]);
+ st.matches=matches;
+ st.max=max;
+ st.count=0;
+ st.halted=0;
+ old=mi_get_console_cb(h,&old_data);
+ mi_set_console_cb(h,mi_find_cb,&st);
+ st.log=mi_get_log_cb(h,&st.log_data);
+ mi_set_log_cb(h,mi_find_log_cb,&st);
+ mi_send(h,"-interpreter-exec console \"find /b%ld 0x%lx, +%lu%s\"\n",max,
+         start,len,bytes);
+ ok=mi_res_simple_done(h);
+ mi_set_console_cb(h,old,old_data);
+ mi_set_log_cb(h,st.log,st.log_data);
+ free(bytes);
+ /* The matches after the unreadable part are missing. */
+ return ok && !st.halted ? st.count : -1;
+}
+
+/* Reads the memory in big blocks and looks for the pattern. Consecutive
+   blocks overlap, so we find the matches that cross the border. */
+static
+long mi_find_memory_client(mi_h *h, unsigned long start, unsigned long len,
+                           const unsigned char *pat, size_t plen,
+                           unsigned long *matches, long max)
+{
+ unsigned char *buf=(unsigned char *)mi_malloc(MI_FIND_CHUNK+plen-1);
+ const unsigned char *b, *e, *p;
+ mi_mem_region *regs, *r;
+ unsigned long pos, n;
+ long count=0;
+
+ if (!buf)
+    return -1;
+ for (pos=0; pos<len && count<max; pos+=MI_FIND_CHUNK)
+    {
+     n=len-pos;
+     if (n>MI_FIND_CHUNK+plen-1)
+        n=MI_FIND_CHUNK+plen-1;
+     if (n<plen)
+        break;
+     if (gmi_read_memory_bytes(h,start+pos,n,buf,&regs)<0)
+       {
+        free(buf);
+        return -1;
+       }
+     /* Matches can't cross the holes. */
+     for (r=regs; r && count<max; r=r->next)
+        {
+         b=buf+(r->start-start-pos);
+         e=b+(r->end-r->start);
+         for (p=b; count<max && (p=mi_mem_find(p,e-p,pat,plen))!=NULL; p++)
+            {
+             /* The rest belongs to the next block. */
+             if (p-buf>=MI_FIND_CHUNK)
+                break;
+             matches[count++]=start+pos+(p-buf);
+            }
+        }
+     mi_free_mem_region(regs);
+    }
+ free(buf);
+ return count;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Searches [@var{start},@var{start}+@var{len}) for the @var{plen} bytes at
+@var{pat}. Up to @var{max} addresses are stored in @var{matches}, matches
+can overlap. The find command is used, so gdb does the search, if it fails
+(i.e. old gdb or gdb warns that it halted at memory it can't read) we read
+the memory in blocks and search it here. Unreadable parts are skipped in
+this case.
+
+  Command: find (CLI) or -data-read-memory-bytes
+  Return: The number of matches or -1 on error.
+
+***************************************************************************/
+
+long gmi_find_memory(mi_h *h, unsigned long start, unsigned long len,
+                     const unsigned char *pat, size_t plen,
+                     unsigned long *matches, long max)
+{
+ long ret;
+
+ if (!plen || max<=0 || len<plen)
+    return 0;
+ ret=mi_find_memory_gdb(h,start,len,pat,plen,matches,max);
+ if (ret<0)
+    ret=mi_find_memory_client(h,start,len,pat,plen,matches,max);
+ return ret;
+}
+
+/* Gets the block for the command already sent and stores it in the
+   disassembly cache. */
+static
+mi_asm_block *mi_get_asm_block_cache(mi_h *h, const char *key)
+{
+ mi_asm_block *b=mi_get_asm_block(h);
+
+ if (b && key)
+    mi_disasm_cache_put(h,key,b);
+ return b;
+}
+
+static
+mi_asm_insns *mi_asm_block_to_insns_free(mi_asm_block *b)
+{
+ mi_asm_insns *r=b ? mi_asm_block_to_insns(b) : NULL;
+
+ mi_free_asm_block(b);
+ return r;
+}
+
+mi_asm_block *gmi_data_disassemble_se_b(mi_h *h, const char *start,
+                                        const char *end, int mode)
+{
+ char *key=mi_disasm_cache_key(h,"se",start,end,mode);
+ mi_asm_block *b=mi_disasm_cache_get(h,key);
+
+ if (!b)
+   {
+    mi_data_disassemble_se(h,start,end,mode);
+    b=mi_get_asm_block_cache(h,key);
+   }
+ free(key);
+ return b;
+}
+
+mi_asm_block *gmi_data_disassemble_fl_b(mi_h *h, const char *file, int line,
+                                        int lines, int mode)
+{
+ char range[32], *key;
+ mi_asm_block *b;
+
+ snprintf(range,sizeof(range),"%d %d",line,lines);
+ key=mi_disasm_cache_key(h,"fl",file,range,mode);
+ b=mi_disasm_cache_get(h,key);
+ if (!b)
+   {
+    mi_data_disassemble_fl(h,file,line,lines,mode);
+    b=mi_get_asm_block_cache(h,key);
+   }
+ free(key);
+ return b;
+}
+
+/* With the disassembly cache enabled the lists are created from the
+   blocks. */
 mi_asm_insns *gmi_data_disassemble_se(mi_h *h, const char *start,
                                       const char *end, int mode)
 {
+ if (h->dcache)
+    return mi_asm_block_to_insns_free(gmi_data_disassemble_se_b(h,start,end,
+                                                                mode));
  mi_data_disassemble_se(h,start,end,mode);
  return mi_get_asm_insns(h);
 }
@@ -217,6 +633,9 @@ mi_asm_insns *gmi_data_disassemble_se(mi_h *h, const char *start,
 mi_asm_insns *gmi_data_disassemble_fl(mi_h *h, const char *file, int line,
                                       int lines, int mode)
 {
+ if (h->dcache)
+    return mi_asm_block_to_insns_free(gmi_data_disassemble_fl_b(h,file,line,
+                                                                lines,mode));
  mi_data_disassemble_fl(h,file,line,lines,mode);
  return mi_get_asm_insns(h);
 }
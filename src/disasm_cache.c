@@ -0,0 +1,810 @@
+/**[txh]********************************************************************
+
+  GDB/MI interface library
+  Copyright (c) 2004-2016 by Salvador E. Tropea.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+  Module: Disassembly cache.
+  Comments:
+  Keeps the results of gmi_data_disassemble_se, gmi_data_disassemble_fl
+and their _b versions. The disassembly of an object doesn't change, so the
+entries are keyed by the object (its GNU build-id, or the file name, mtime
+and size when it doesn't have one), the range and the mode. The object is
+taken from the -file-exec-and-symbols and -file-symbol-file commands (also
+the CLI file and symbol-file), or set using @x{mi_disasm_cache_object}.
+Only ranges with numeric addresses are cached, expressions like $pc can
+change. The instructions must be inside the executable segments of the
+object, other code (shared libraries, etc.) isn't cached.@p
+  The instructions are stored as the arrays of a mi_asm_block, serialized
+in one block. Optionally they are kept in a file instead, the file is
+mapped in memory, so the next session for the same binary starts with the
+cache filled. Many sessions can share the file, it's locked (flock) while
+we add entries and a key already in the file isn't added again. The file
+uses the host byte order:@p
+
+@<pre>
+"MIGDBDIS", version (32 bits), reserved (32 bits)
+Entries: key length (32 bits, with EOS), data length (32 bits), key, data
+@</pre>
+
+***************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include "mi_gdb.h"
+
+#define MI_DIS_MAGIC   "MIGDBDIS"
+#define MI_DIS_VERSION 2
+#define MI_DIS_HEADER  16
+
+static
+unsigned mi_disasm_hash(mi_disasm_cache *c, const char *key)
+{
+ unsigned v=2166136261u;
+
+ for (; *key; key++)
+     v=(v ^ (unsigned char)*key)*16777619u;
+ return v & (c->hash_size-1);
+}
+
+/* Releases the entries of one of the hash tables. */
+static
+void mi_disasm_free_entries(mi_disasm_cache *c, mi_disasm_entry **hash)
+{
+ mi_disasm_entry *e, *n;
+ int i;
+
+ for (i=0; i<c->hash_size; i++)
+    {
+     for (e=hash[i]; e; e=n)
+        {
+         n=e->next;
+         if (!e->mapped)
+           {
+            free((char *)e->key);
+            free((unsigned char *)e->data);
+           }
+         free(e);
+        }
+     hash[i]=NULL;
+    }
+}
+
+/* The entries of the file point to the map, it moves when the file grows.
+   So they are stored as offsets. */
+static
+const char *mi_disasm_key(mi_disasm_cache *c, mi_disasm_entry *e)
+{
+ return e->mapped ? (const char *)c->map+e->koff : e->key;
+}
+
+static
+mi_disasm_entry *mi_disasm_find(mi_disasm_cache *c, mi_disasm_entry **hash,
+                                const char *key)
+{
+ mi_disasm_entry *e=hash[mi_disasm_hash(c,key)];
+
+ while (e && strcmp(mi_disasm_key(c,e),key))
+    e=e->next;
+ return e;
+}
+
+static
+void mi_disasm_link(mi_disasm_cache *c, mi_disasm_entry **hash,
+                    mi_disasm_entry *e)
+{
+ unsigned i=mi_disasm_hash(c,mi_disasm_key(c,e));
+
+ e->next=hash[i];
+ hash[i]=e;
+}
+
+/* Entries kept in memory, they aren't copied. When the cache is full all
+   of them are discarded. */
+static
+int mi_disasm_add(mi_disasm_cache *c, const char *key,
+                  const unsigned char *data, size_t size)
+{
+ mi_disasm_entry *e;
+
+ if (c->count>=c->max)
+   {
+    mi_disasm_free_entries(c,c->hash);
+    c->count=0;
+   }
+ e=(mi_disasm_entry *)mi_calloc1(sizeof(mi_disasm_entry));
+ if (!e)
+    return 0;
+ e->key=key;
+ e->data=data;
+ e->size=size;
+ mi_disasm_link(c,c->hash,e);
+ c->count++;
+ return 1;
+}
+
+static
+int mi_disasm_write(int fd, const void *buf, size_t len, off_t off)
+{
+ ssize_t w;
+
+ while (len)
+   {
+    w=TEMP_FAILURE_RETRY(pwrite(fd,buf,len,off));
+    if (w<=0)
+      {
+       mi_error=MI_FILE_IO;
+       return 0;
+      }
+    buf=(const char *)buf+w;
+    len-=w;
+    off+=w;
+   }
+ return 1;
+}
+
+/* Other sessions can use the same file, the lock is held while we read or
+   change its structure. */
+static
+int mi_disasm_lock(mi_disasm_cache *c, int op)
+{
+ if (TEMP_FAILURE_RETRY(flock(c->fd,op)))
+   {
+    mi_error=MI_FILE_IO;
+    return 0;
+   }
+ return 1;
+}
+
+/* Maps the whole file and adds to the file index the entries written after
+   c->end, by us or by other sessions. A damaged tail is overwritten by the
+   next entry. Must be called with the lock. */
+static
+int mi_disasm_sync(mi_disasm_cache *c)
+{
+ struct stat st;
+ const unsigned char *p, *e;
+ mi_disasm_entry *n;
+ uint32_t klen, dlen;
+
+ if (fstat(c->fd,&st))
+   {
+    mi_error=MI_FILE_IO;
+    return 0;
+   }
+ if ((size_t)st.st_size>c->map_size)
+   {
+    if (c->map)
+       munmap(c->map,c->map_size);
+    c->map=mmap(NULL,st.st_size,PROT_READ,MAP_SHARED,c->fd,0);
+    if (c->map==MAP_FAILED)
+      {/* The offsets in the index are useless without the map. */
+       c->map=NULL;
+       c->map_size=0;
+       c->end=MI_DIS_HEADER;
+       mi_disasm_free_entries(c,c->findex);
+       mi_error=MI_FILE_IO;
+       return 0;
+      }
+    c->map_size=st.st_size;
+   }
+ if (!c->map)
+    return 1;
+ p=(const unsigned char *)c->map+c->end;
+ e=(const unsigned char *)c->map+c->map_size;
+ while (e-p>=8)
+   {
+    memcpy(&klen,p,4);
+    memcpy(&dlen,p+4,4);
+    if (!klen || klen>(size_t)(e-p-8) || dlen>(size_t)(e-p-8-klen) ||
+        p[8+klen-1])
+       break;
+    n=(mi_disasm_entry *)mi_calloc1(sizeof(mi_disasm_entry));
+    if (!n)
+       return 0;
+    n->mapped=1;
+    n->koff=p+8-(const unsigned char *)c->map;
+    n->doff=n->koff+klen;
+    n->size=dlen;
+    mi_disasm_link(c,c->findex,n);
+    p+=8+klen+dlen;
+   }
+ c->end=p-(const unsigned char *)c->map;
+ return 1;
+}
+
+/* Checks the header of the file and indexes its entries. */
+static
+int mi_disasm_load(mi_disasm_cache *c)
+{
+ char hd[MI_DIS_HEADER], ref[MI_DIS_HEADER];
+ uint32_t v=MI_DIS_VERSION;
+ int ret=1;
+
+ if (!mi_disasm_lock(c,LOCK_EX))
+    return 0;
+ memset(ref,0,sizeof(ref));
+ memcpy(ref,MI_DIS_MAGIC,8);
+ memcpy(ref+8,&v,4);
+ if (TEMP_FAILURE_RETRY(pread(c->fd,hd,MI_DIS_HEADER,0))!=MI_DIS_HEADER ||
+     memcmp(hd,ref,12))
+   {/* New or not ours, start again. */
+    if (ftruncate(c->fd,0) || !mi_disasm_write(c->fd,ref,MI_DIS_HEADER,0))
+      {
+       mi_error=MI_FILE_IO;
+       ret=0;
+      }
+   }
+ c->end=MI_DIS_HEADER;
+ if (ret)
+    ret=mi_disasm_sync(c);
+ mi_disasm_lock(c,LOCK_UN);
+ return ret;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Enables the disassembly cache. @var{entries} is the maximum number of
+disassembled ranges we keep, when the cache is full all of them are
+discarded. Using 0 disables the cache and releases it. If @var{file} isn't
+NULL the entries are stored there instead, the ones stored by previous
+sessions (or by other sessions using the same file) are also used. The
+file is mapped in memory, so the limit doesn't apply to it.
+
+  Return: !=0 OK.
+
+***************************************************************************/
+
+int mi_set_disasm_cache(mi_h *h, int entries, const char *file)
+{
+ mi_disasm_cache *c=h->dcache;
+ int size;
+
+ if (c)
+   {
+    mi_disasm_free_entries(c,c->hash);
+    if (c->findex)
+       mi_disasm_free_entries(c,c->findex);
+    if (c->map)
+       munmap(c->map,c->map_size);
+    if (c->fd>=0)
+       close(c->fd);
+    free(c->obj);
+    free(c->text);
+    free(c->hash);
+    free(c->findex);
+    free(c);
+    h->dcache=NULL;
+   }
+ if (entries<=0)
+    return 1;
+ c=(mi_disasm_cache *)mi_calloc1(sizeof(mi_disasm_cache));
+ if (!c)
+    return 0;
+ for (size=16; size<entries && size<(1<<20); size<<=1);
+ c->hash=(mi_disasm_entry **)mi_calloc(size,sizeof(mi_disasm_entry *));
+ if (!c->hash)
+   {
+    free(c);
+    return 0;
+   }
+ c->hash_size=size;
+ c->max=entries;
+ c->fd=-1;
+ h->dcache=c;
+ if (file)
+   {
+    c->findex=(mi_disasm_entry **)mi_calloc(size,sizeof(mi_disasm_entry *));
+    if (!c->findex)
+      {
+       mi_set_disasm_cache(h,0,NULL);
+       return 0;
+      }
+    c->fd=open(file,O_RDWR | O_CREAT,0644);
+    if (c->fd<0)
+      {
+       mi_error=MI_FILE_IO;
+       mi_set_disasm_cache(h,0,NULL);
+       return 0;
+      }
+    if (!mi_disasm_load(c))
+      {
+       mi_set_disasm_cache(h,0,NULL);
+       return 0;
+      }
+   }
+ return 1;
+}
+
+static
+uint64_t mi_elf_get(const unsigned char *s, int n, int big)
+{
+ uint64_t v=0;
+ int i;
+
+ for (i=0; i<n; i++)
+     v|=(uint64_t)s[big ? i : n-1-i]<<(8*(n-1-i));
+ return v;
+}
+
+/* Adds the range of an executable PT_LOAD segment. */
+static
+int mi_disasm_add_text(mi_disasm_cache *c, uint64_t start, uint64_t size)
+{
+ unsigned long *n;
+
+ if (!size)
+    return 1;
+ n=(unsigned long *)realloc(c->text,(c->ntext+1)*2*sizeof(unsigned long));
+ if (!n)
+   {
+    mi_error=MI_OUT_OF_MEMORY;
+    return 0;
+   }
+ c->text=n;
+ n[c->ntext*2]=start;
+ n[c->ntext*2+1]=start+size;
+ c->ntext++;
+ return 1;
+}
+
+/* Looks for the NT_GNU_BUILD_ID note in the PT_NOTE segments of an ELF
+   file and collects the addresses of the executable PT_LOAD segments. */
+static
+int mi_elf_scan(mi_disasm_cache *c, int fd, char *dest, size_t size)
+{
+ unsigned char eh[64], ph[56], *notes, *p;
+ uint64_t phoff, off, len, namesz, descsz;
+ int is64, big, phentsize, phnum, i, type, found=0;
+
+ if (TEMP_FAILURE_RETRY(pread(fd,eh,64,0))!=64 || memcmp(eh,"\177ELF",4) ||
+     (eh[4]!=1 && eh[4]!=2))
+    return 0;
+ is64=eh[4]==2;
+ big=eh[5]==2;
+ phoff=is64 ? mi_elf_get(eh+32,8,big) : mi_elf_get(eh+28,4,big);
+ phentsize=mi_elf_get(eh+(is64 ? 54 : 42),2,big);
+ phnum=mi_elf_get(eh+(is64 ? 56 : 44),2,big);
+ if (phentsize<(is64 ? 56 : 32))
+    return 0;
+ for (i=0; i<phnum; i++)
+    {
+     if (TEMP_FAILURE_RETRY(pread(fd,ph,is64 ? 56 : 32,
+         phoff+(uint64_t)i*phentsize))!=(is64 ? 56 : 32))
+        continue;
+     type=mi_elf_get(ph,4,big);
+     if (type==1)
+       {/* PT_LOAD, only the ones with PF_X. */
+        if ((is64 ? mi_elf_get(ph+4,4,big) : mi_elf_get(ph+24,4,big)) & 1 &&
+            !mi_disasm_add_text(c,
+               is64 ? mi_elf_get(ph+16,8,big) : mi_elf_get(ph+8,4,big),
+               is64 ? mi_elf_get(ph+40,8,big) : mi_elf_get(ph+20,4,big)))
+           return 0;
+        continue;
+       }
+     if (type!=4 || found)
+        continue;
+     off=is64 ? mi_elf_get(ph+8,8,big) : mi_elf_get(ph+4,4,big);
+     len=is64 ? mi_elf_get(ph+32,8,big) : mi_elf_get(ph+16,4,big);
+     if (len>65536)
+        continue;
+     notes=(unsigned char *)mi_malloc(len ? len : 1);
+     if (!notes)
+        return 0;
+     if (TEMP_FAILURE_RETRY(pread(fd,notes,len,off))==(ssize_t)len)
+        for (p=notes; !found && notes+len-p>=12; )
+           {
+            namesz=mi_elf_get(p,4,big);
+            descsz=mi_elf_get(p+4,4,big);
+            if (namesz>len || descsz>len ||
+                (uint64_t)(notes+len-p-12)<((namesz+3) & ~3)+descsz)
+               break;
+            if (mi_elf_get(p+8,4,big)==3 && namesz==4 &&
+                memcmp(p+12,"GNU",4)==0 && 9+2*descsz<=size)
+              {
+               strcpy(dest,"build-id:");
+               mi_hex_encode(dest+9,p+12+4,descsz);
+               dest[9+2*descsz]=0;
+               found=1;
+              }
+            p+=12+((namesz+3) & ~3)+((descsz+3) & ~3);
+           }
+     free(notes);
+    }
+ return found;
+}
+
+/* Checks if the start..end range is inside the code of the object. */
+static
+int mi_disasm_in_object(mi_disasm_cache *c, unsigned long start,
+                        unsigned long end)
+{
+ int i;
+
+ for (i=0; i<c->ntext; i++)
+     if (start>=c->text[i*2] && end<=c->text[i*2+1])
+        return 1;
+ return 0;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Sets the object used as key for the disassembly cache. The key is the
+GNU build-id of @var{file} or, if it doesn't have one, the name, mtime and
+size of the file. Called when we send commands that load a file, but you
+can use it if the file is loaded by other means. A NULL @var{file} disables
+the caching until the next file is loaded.@p
+  Only the instructions that are inside the executable segments of
+@var{file} are cached, at the addresses found in the file. So shared
+libraries, code loaded at run time and relocated code (i.e. a PIE already
+running) aren't cached, and nothing is cached if @var{file} isn't ELF.
+
+  Return: !=0 OK.
+
+***************************************************************************/
+
+int mi_disasm_cache_object(mi_h *h, const char *file)
+{
+ mi_disasm_cache *c=h->dcache;
+ char id[2*64+16];
+ struct stat st;
+ int fd;
+
+ if (!c)
+    return 0;
+ free(c->obj);
+ c->obj=NULL;
+ free(c->text);
+ c->text=NULL;
+ c->ntext=0;
+ if (!file)
+    return 1;
+ fd=open(file,O_RDONLY);
+ if (fd<0)
+    return 0;
+ if (mi_elf_scan(c,fd,id,sizeof(id)))
+    c->obj=strdup(id);
+ else if (fstat(fd,&st)==0 &&
+          asprintf(&c->obj,"file:%s:%ld:%ld",file,(long)st.st_mtime,
+                   (long)st.st_size)<0)
+    c->obj=NULL;
+ close(fd);
+ return c->obj!=NULL;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Returns how many disassembly requests were found in the cache and how
+many had to be requested to gdb.
+
+***************************************************************************/
+
+void mi_get_disasm_cache_stats(mi_h *h, unsigned long *hits,
+                               unsigned long *misses)
+{
+ mi_disasm_cache *c=h->dcache;
+
+ if (hits)
+    *hits=c ? c->hits : 0;
+ if (misses)
+    *misses=c ? c->misses : 0;
+}
+
+/* Commands that load an object, the file name is the last argument. */
+static const char *mi_dis_cmds[]=
+{
+ "-file-exec-and-symbols ", "-file-symbol-file ", "file ", "symbol-file ",
+ NULL
+};
+
+/* Called for each command we send to gdb, follows the loaded object. */
+void mi_disasm_cache_cmd(mi_h *h, const char *cmd)
+{
+ char *file, *s;
+ const char *e;
+ int i;
+
+ if (!h->dcache)
+    return;
+ while (isdigit((unsigned char)*cmd))
+    cmd++;
+ for (i=0; mi_dis_cmds[i]; i++)
+     if (strncmp(cmd,mi_dis_cmds[i],strlen(mi_dis_cmds[i]))==0)
+        break;
+ if (!mi_dis_cmds[i])
+    return;
+ cmd+=strlen(mi_dis_cmds[i]);
+ /* Skip options like -readnow. */
+ while (*cmd==' ' || *cmd=='-')
+   {
+    if (*cmd=='-')
+       while (*cmd && *cmd!=' ' && *cmd!='\n')
+          cmd++;
+    else
+       cmd++;
+   }
+ for (e=cmd; *e && *e!='\n'; e++);
+ while (e>cmd && e[-1]==' ')
+    e--;
+ if (e-cmd>=2 && *cmd=='"' && e[-1]=='"')
+   {
+    cmd++;
+    e--;
+   }
+ if (e==cmd)
+   {/* Unloaded. */
+    mi_disasm_cache_object(h,NULL);
+    return;
+   }
+ file=mi_malloc(e-cmd+1);
+ if (!file)
+    return;
+ for (s=file; cmd<e; cmd++)
+    {
+     if (*cmd=='\\' && cmd+1<e)
+        cmd++;
+     *s++=*cmd;
+    }
+ *s=0;
+ mi_disasm_cache_object(h,file);
+ free(file);
+}
+
+static
+int mi_is_number(const char *s)
+{
+ char *end;
+
+ if (!s || !isdigit((unsigned char)*s))
+    return 0;
+ strtoul(s,&end,0);
+ return *end==0;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Creates the key for a disassembly request. @var{kind} is "se" for a
+range (@var{a} and @var{b} are the start and end) or "fl" for a file and
+line (@var{a} is the file and @var{b} the line and number of lines).
+
+  Return: The key, release it using free. NULL if the cache is disabled,
+we don't know the object, the range isn't constant or it isn't inside the
+object.
+
+***************************************************************************/
+
+char *mi_disasm_cache_key(mi_h *h, const char *kind, const char *a,
+                          const char *b, int mode)
+{
+ mi_disasm_cache *c=h->dcache;
+ char *key;
+
+ if (!c || !c->obj || !c->ntext)
+    return NULL;
+ if (strcmp(kind,"se")==0 &&
+     (!mi_is_number(a) || !mi_is_number(b) ||
+      !mi_disasm_in_object(c,strtoul(a,NULL,0),strtoul(b,NULL,0))))
+    return NULL;
+ if (asprintf(&key,"%s %d %s %s %s",c->obj,mode,kind,a,b)<0)
+    return NULL;
+ return key;
+}
+
+/* The blocks are stored as: count, nlines and text size (32 bits each),
+   the addresses (64 bits each), the other arrays and the text. */
+static
+size_t mi_disasm_packed_size(int count, int nlines, size_t text_size)
+{
+ return 12+count*(8+3*4)+nlines*2*4+(nlines+1)*4+text_size;
+}
+
+static
+mi_asm_block *mi_disasm_unpack(const unsigned char *p, size_t size)
+{
+ uint32_t count, nlines, tsize, i;
+ uint64_t addr;
+ mi_asm_block *b;
+
+ if (size<12)
+    return NULL;
+ memcpy(&count,p,4);
+ memcpy(&nlines,p+4,4);
+ memcpy(&tsize,p+8,4);
+ if (count>size || nlines>size || tsize>size ||
+     mi_disasm_packed_size(count,nlines,tsize)!=size || !tsize)
+    return NULL;
+ b=mi_alloc_asm_block(count,nlines,tsize);
+ if (!b)
+    return NULL;
+ for (p+=12, i=0; i<count; i++, p+=8)
+    {
+     memcpy(&addr,p,8);
+     b->addr[i]=addr;
+    }
+ memcpy(b->offset,p,count*4);
+ memcpy(b->func,p+=count*4,count*4);
+ memcpy(b->inst,p+=count*4,count*4);
+ memcpy(b->line,p+=count*4,nlines*4);
+ memcpy(b->file,p+=nlines*4,nlines*4);
+ memcpy(b->first,p+=nlines*4,(nlines+1)*4);
+ memcpy(b->text,p+=(nlines+1)*4,tsize);
+ /* Don't trust the offsets of the strings. */
+ b->text[tsize-1]=0;
+ for (i=0; i<count; i++)
+     if (b->func[i]>=tsize || b->inst[i]>=tsize)
+        b->func[i]=b->inst[i]=0;
+ for (i=0; i<nlines; i++)
+    {
+     if (b->file[i]>=tsize)
+        b->file[i]=0;
+     if (b->first[i]<0 || b->first[i]>b->first[i+1])
+        b->first[i]=b->first[i+1]=0;
+    }
+ if (nlines && (b->first[nlines]<0 || b->first[nlines]>(int)count))
+   {
+    free(b);
+    return NULL;
+   }
+ return b;
+}
+
+static
+void mi_disasm_pack(mi_asm_block *b, unsigned char *p)
+{
+ uint32_t v;
+ uint64_t addr;
+ int i;
+
+ v=b->count;
+ memcpy(p,&v,4);
+ v=b->nlines;
+ memcpy(p+4,&v,4);
+ v=b->text_size;
+ memcpy(p+8,&v,4);
+ for (p+=12, i=0; i<b->count; i++, p+=8)
+    {
+     addr=b->addr[i];
+     memcpy(p,&addr,8);
+    }
+ memcpy(p,b->offset,b->count*4);
+ memcpy(p+=b->count*4,b->func,b->count*4);
+ memcpy(p+=b->count*4,b->inst,b->count*4);
+ memcpy(p+=b->count*4,b->line,b->nlines*4);
+ memcpy(p+=b->nlines*4,b->file,b->nlines*4);
+ memcpy(p+=b->nlines*4,b->first,(b->nlines+1)*4);
+ memcpy(p+(b->nlines+1)*4,b->text,b->text_size);
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Looks for the disassembly stored with @var{key}.
+
+  Return: A new copy of the instructions or NULL if not in the cache.
+Release it using mi_free_asm_block.
+
+***************************************************************************/
+
+mi_asm_block *mi_disasm_cache_get(mi_h *h, const char *key)
+{
+ mi_disasm_cache *c=h->dcache;
+ mi_disasm_entry *e;
+ mi_asm_block *b=NULL;
+
+ if (!c || !key)
+    return NULL;
+ if (c->fd<0)
+   {
+    e=mi_disasm_find(c,c->hash,key);
+    if (e)
+       b=mi_disasm_unpack(e->data,e->size);
+   }
+ else
+   {
+    e=mi_disasm_find(c,c->findex,key);
+    if (!e && mi_disasm_lock(c,LOCK_SH))
+      {/* Could be added by other session. */
+       mi_disasm_sync(c);
+       mi_disasm_lock(c,LOCK_UN);
+       e=mi_disasm_find(c,c->findex,key);
+      }
+    if (e)
+       b=mi_disasm_unpack((const unsigned char *)c->map+e->doff,e->size);
+   }
+ if (b)
+    c->hits++;
+ else
+    c->misses++;
+ return b;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Stores a copy of the instructions @var{b} using @var{key}, also in the
+file if we have one. Instructions outside the object (i.e. a file and line
+of a shared library) aren't stored.
+
+  Return: !=0 OK.
+
+***************************************************************************/
+
+int mi_disasm_cache_put(mi_h *h, const char *key, mi_asm_block *b)
+{
+ mi_disasm_cache *c=h->dcache;
+ unsigned char *data, hd[8];
+ uint32_t klen, dlen;
+ char *k;
+ size_t size;
+ int i, ret;
+
+ if (!c || !key)
+    return 0;
+ for (i=0; i<b->count; i++)
+     if (!mi_disasm_in_object(c,b->addr[i],b->addr[i]+1))
+        return 0;
+ size=mi_disasm_packed_size(b->count,b->nlines,b->text_size);
+ if (c->fd<0 && mi_disasm_find(c,c->hash,key))
+    return 1;
+ data=(unsigned char *)mi_malloc(size);
+ if (!data)
+    return 0;
+ mi_disasm_pack(b,data);
+ if (c->fd>=0)
+   {/* Append it if nobody did it, c->end is the end of the last good
+       entry. */
+    if (!mi_disasm_lock(c,LOCK_EX))
+      {
+       free(data);
+       return 0;
+      }
+    ret=mi_disasm_sync(c);
+    if (ret && !mi_disasm_find(c,c->findex,key))
+      {
+       klen=strlen(key)+1;
+       dlen=size;
+       memcpy(hd,&klen,4);
+       memcpy(hd+4,&dlen,4);
+       ret=mi_disasm_write(c->fd,hd,8,c->end) &&
+           mi_disasm_write(c->fd,key,klen,c->end+8) &&
+           mi_disasm_write(c->fd,data,dlen,c->end+8+klen) &&
+           mi_disasm_sync(c);
+      }
+    mi_disasm_lock(c,LOCK_UN);
+    free(data);
+    return ret;
+   }
+ k=strdup(key);
+ if (!k || !mi_disasm_add(c,k,data,size))
+   {
+    free(data);
+    free(k);
+    return 0;
+   }
+ return 1;
+}
@@ -0,0 +1,319 @@
+/**[txh]********************************************************************
+
+  GDB/MI interface library
+  Copyright (c) 2004-2016 by Salvador E. Tropea.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+  Module: dprintf probes.
+  Comments:
+  Logging breakpoints that don't stop the inferior. Each probe is a gdb
+dprintf that prints "MIDP<probe>" followed by its fields, separated by
+tabs. gdb sends it as console output (or target output, depending on
+dprintf-style), the library takes these lines out of the stream, splits
+them and stores them in a ring buffer, the console callback never sees
+them. When the ring is full the oldest events are lost.@p
+  gdb also reports each hit using =breakpoint-modified, for breakpoints of
+type dprintf these records are discarded after updating the breakpoints
+table, so the async callback isn't called for them.@p
+  The time stamp is the moment we read the line, not the moment of the hit.
+A line must arrive in only one stream record, that's what gdb does.@p
+
+***************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "mi_gdb.h"
+
+#define MI_DPRINTF_MARK "MIDP"
+
+/**[txh]********************************************************************
+
+  Description:
+  Enables the capture of the dprintf probes output. @var{events} is the
+size of the ring buffer. Using 0 disables it and releases the buffer, the
+probes already inserted are forgotten, but they remain in gdb.
+
+  Return: !=0 OK.
+
+***************************************************************************/
+
+int mi_set_dprintf(mi_h *h, int events)
+{
+ mi_dprintf *d=h->dprintf;
+
+ if (d)
+   {
+    free(d->ring);
+    free(d->probes);
+    free(d);
+    h->dprintf=NULL;
+   }
+ if (events<=0)
+    return 1;
+ d=(mi_dprintf *)mi_calloc1(sizeof(mi_dprintf));
+ if (!d)
+    return 0;
+ d->ring=(mi_dprintf_ev *)mi_calloc(events,sizeof(mi_dprintf_ev));
+ if (!d->ring)
+   {
+    free(d);
+    return 0;
+   }
+ d->size=events;
+ h->dprintf=d;
+ return 1;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Inserts a dprintf probe at @var{where}. Each hit prints the @var{nfields}
+expressions in @var{exps} (up to MI_DPRINTF_FIELDS), using the printf
+conversions in @var{fmts}. If @var{fmts} (or one of its elements) is NULL
+%ld is used, gdb converts the values as needed. @var{cond} is an optional
+condition. The capture must be enabled using @x{mi_set_dprintf}.
+
+  Command: -dprintf-insert
+  Return: The probe number, used for the events, or 0 on error.
+
+***************************************************************************/
+
+int gmi_dprintf_insert(mi_h *h, const char *where, const char *cond,
+                       int nfields, const char **exps, const char **fmts)
+{
+ mi_dprintf *d=h->dprintf;
+ size_t len;
+ char *cmd, *p;
+ int i, probe;
+ mi_dprintf_probe *np;
+ mi_bkpt *b;
+
+ if (!d || nfields<0 || nfields>MI_DPRINTF_FIELDS)
+    return 0;
+ probe=d->nprobes+1;
+ np=(mi_dprintf_probe *)realloc(d->probes,probe*sizeof(mi_dprintf_probe));
+ if (!np)
+   {
+    mi_error=MI_OUT_OF_MEMORY;
+    return 0;
+   }
+ d->probes=np;
+ /* -dprintf-insert -c "cond" where "MIDPn\t%ld\n" "exp" */
+ len=64+strlen(where)+(cond ? strlen(cond) : 0);
+ for (i=0; i<nfields; i++)
+     len+=strlen(exps[i])+(fmts && fmts[i] ? strlen(fmts[i]) : 3)+8;
+ cmd=(char *)mi_malloc(len);
+ if (!cmd)
+    return 0;
+ p=cmd+sprintf(cmd,"-dprintf-insert ");
+ if (cond)
+    p+=sprintf(p,"-c \"%s\" ",cond);
+ p+=sprintf(p,"%s \"" MI_DPRINTF_MARK "%d",where,probe);
+ for (i=0; i<nfields; i++)
+     p+=sprintf(p,"\\t%s",fmts && fmts[i] ? fmts[i] : "%ld");
+ p+=sprintf(p,"\\n\"");
+ for (i=0; i<nfields; i++)
+     p+=sprintf(p," \"%s\"",exps[i]);
+ strcpy(p,"\n");
+ mi_send(h,"%s",cmd);
+ free(cmd);
+
+ b=mi_res_bkpt(h);
+ if (!b)
+    return 0;
+ if (h->btable)
+    mi_bkpt_table_add(h,b);
+ np[probe-1].bkpt=b->number;
+ np[probe-1].nfields=nfields;
+ d->nprobes=probe;
+ mi_free_bkpt(b);
+ return probe;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Returns the breakpoint number gdb assigned to the dprintf @var{probe}.
+
+  Return: The number or 0 if the probe isn't known.
+
+***************************************************************************/
+
+int mi_get_dprintf_bkpt(mi_h *h, int probe)
+{
+ mi_dprintf *d=h->dprintf;
+
+ if (!d || probe<=0 || probe>d->nprobes)
+    return 0;
+ return d->probes[probe-1].bkpt;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Removes the dprintf @var{probe}. Events already in the ring buffer are
+kept.
+
+  Command: -break-delete
+  Return: !=0 OK.
+
+***************************************************************************/
+
+int gmi_dprintf_delete(mi_h *h, int probe)
+{
+ int number=mi_get_dprintf_bkpt(h,probe);
+
+ if (!number || !gmi_break_delete(h,number))
+    return 0;
+ h->dprintf->probes[probe-1].bkpt=0;
+ return 1;
+}
+
+/* Stores the line of a probe, s points after the mark. Returns 0 if it
+   isn't one of our probes. Tabs printed by the last field are kept. */
+static
+int mi_dprintf_line(mi_dprintf *d, const char *s, size_t len)
+{
+ mi_dprintf_ev *ev;
+ struct timespec ts;
+ const char *end=s+len;
+ char *t;
+ int probe=0, nfields;
+
+ for (; s<end && isdigit((unsigned char)*s); s++)
+     probe=probe*10+*s-'0';
+ if (probe<=0 || probe>d->nprobes || (s<end && *s!='\t' && *s!='\n'))
+    return 0;
+ if (end>s && end[-1]=='\n')
+    end--;
+ if (d->next-d->first>=d->size)
+   {/* Full, the oldest is lost. */
+    d->first++;
+    d->lost++;
+   }
+ ev=d->ring+d->next%d->size;
+ d->next++;
+ clock_gettime(CLOCK_MONOTONIC,&ts);
+ ev->stamp=(unsigned long long)ts.tv_sec*1000000000ULL+ts.tv_nsec;
+ ev->probe=probe;
+ ev->nfields=0;
+ nfields=d->probes[probe-1].nfields;
+ if (s>=end || !nfields)
+   {
+    ev->text[0]=0;
+    return 1;
+   }
+ /* Skip the tab, the fields are cut if they don't fit. */
+ s++;
+ len=end-s;
+ if (len>=MI_DPRINTF_TEXT)
+    len=MI_DPRINTF_TEXT-1;
+ memcpy(ev->text,s,len);
+ ev->text[len]=0;
+ ev->field[ev->nfields++]=0;
+ t=ev->text;
+ while (ev->nfields<nfields && (t=strchr(t,'\t'))!=NULL)
+   {
+    *t++=0;
+    ev->field[ev->nfields++]=t-ev->text;
+   }
+ return 1;
+}
+
+/* Called for the console and target streams. Takes out the lines printed
+   by our probes. Returns what's left or NULL if nothing. */
+char *mi_dprintf_stream(mi_h *h, char *text)
+{
+ char *s=text, *w=text, *e;
+ size_t len;
+
+ if (!*text)
+    return text;
+ while (*s)
+   {
+    e=strchr(s,'\n');
+    len=e ? (size_t)(e-s+1) : strlen(s);
+    if (strncmp(s,MI_DPRINTF_MARK,4) ||
+        !mi_dprintf_line(h->dprintf,s+4,len-4))
+      {/* Not from a probe, keep it. */
+       if (w!=s)
+          memmove(w,s,len);
+       w+=len;
+      }
+    s+=len;
+   }
+ *w=0;
+ return w==text ? NULL : text;
+}
+
+/* Called for each async record. Returns !=0 for the =breakpoint-modified
+   of a dprintf, they just report a hit. */
+int mi_dprintf_notify(mi_output *o)
+{
+ mi_results *r;
+
+ if (o->tclass!=MI_CL_BKPT_MODIFIED)
+    return 0;
+ r=mi_get_var_r(o->c,"bkpt");
+ if (!r || r->type!=t_tuple)
+    return 0;
+ r=mi_get_var_r(r->v.rs,"type");
+ return r && r->type==t_const && strcmp(r->v.cstr,"dprintf")==0;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Gets the oldest event from the dprintf ring buffer. The fields of
+@var{ev} are in ev->text+ev->field[i]. Note that the events are collected
+while we read gdb output, so you must call @x{mi_process_input} (or any
+function that waits for gdb) while the inferior runs.
+
+  Return: !=0 if we got one, 0 if the buffer is empty.
+
+***************************************************************************/
+
+int mi_get_dprintf_event(mi_h *h, mi_dprintf_ev *ev)
+{
+ mi_dprintf *d=h->dprintf;
+
+ if (!d || d->first==d->next)
+    return 0;
+ *ev=d->ring[d->first%d->size];
+ d->first++;
+ return 1;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Returns how many dprintf events we got and how many were lost because
+the ring buffer was full.
+
+***************************************************************************/
+
+void mi_get_dprintf_stats(mi_h *h, unsigned long long *events,
+                          unsigned long *lost)
+{
+ mi_dprintf *d=h->dprintf;
+
+ if (events)
+    *events=d ? d->next : 0;
+ if (lost)
+    *lost=d ? d->lost : 0;
+}
@@ -41,7 +41,8 @@ const char *error_strs[]=
  "GDB suddenly died",
  "Can't execute X terminal",
  "Failed to create temporal",
- "Can't execute the debugger"
+ "Can't execute the debugger",
+ "Error reading or writing a file"
 };
 
 const char *mi_get_error_str()
@@ -0,0 +1,386 @@
+/**[txh]********************************************************************
+
+  GDB/MI interface library
+  Copyright (c) 2004-2016 by Salvador E. Tropea.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+  Module: Memory cache.
+  Comments:
+  Cache for the target memory. While the inferior is stopped its memory
+doesn't change, so the front-ends that repaint memory views can get it
+without asking gdb again. The memory is kept in pages of MI_MEM_PAGE bytes.
+Pages gdb can't read are also remembered.@p
+  The cache is flushed when we send a command that can change the target
+(-exec-*, -data-write-*, -var-assign, -target-*, CLI commands, etc.) and
+when gdb reports ^running or *running. Memory changed behind our back (i.e.
+from other threads in non-stop mode) isn't detected.@p
+
+***************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stddef.h>
+#include "mi_gdb.h"
+
+#define PAGE_MASK ((unsigned long)MI_MEM_PAGE-1)
+
+static
+int mi_mem_hash(mi_mem_cache *c, unsigned long addr)
+{
+ return (addr/MI_MEM_PAGE) & (c->hash_size-1);
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Enables the target memory cache. @var{pages} is the maximum number of
+pages (MI_MEM_PAGE bytes each) we keep, when the cache is full all the pages
+are discarded. Using 0 disables the cache and releases it. Only the reads
+done using gmi_read_memory_bytes and gmi_read_memory (with a numeric
+address) are cached.
+
+  Return: !=0 OK.
+
+***************************************************************************/
+
+int mi_set_mem_cache(mi_h *h, int pages)
+{
+ mi_mem_cache *c;
+ int size;
+
+ if (h->mcache)
+   {
+    mi_mem_cache_invalidate(h);
+    free(h->mcache->pages);
+    free(h->mcache);
+    h->mcache=NULL;
+   }
+ if (pages<=0)
+    return 1;
+ c=(mi_mem_cache *)mi_calloc1(sizeof(mi_mem_cache));
+ if (!c)
+    return 0;
+ for (size=16; size<pages && size<(1<<20); size<<=1);
+ c->pages=(mi_mem_page **)mi_calloc(size,sizeof(mi_mem_page *));
+ if (!c->pages)
+   {
+    free(c);
+    return 0;
+   }
+ c->hash_size=size;
+ c->max_pages=pages;
+ h->mcache=c;
+ return 1;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Discards all the pages in the memory cache. The library calls it when the
+target could change, but you must call it if the memory is changed by other
+means (i.e. commands sent without using the library).
+
+***************************************************************************/
+
+void mi_mem_cache_invalidate(mi_h *h)
+{
+ mi_mem_cache *c=h->mcache;
+ mi_mem_page *p, *n;
+ int i;
+
+ if (!c || !c->npages)
+    return;
+ for (i=0; i<c->hash_size; i++)
+    {
+     for (p=c->pages[i]; p; p=n)
+        {
+         n=p->next;
+         free(p);
+        }
+     c->pages[i]=NULL;
+    }
+ c->npages=0;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Returns how many pages were found in the memory cache and how many had to
+be requested to gdb.
+
+***************************************************************************/
+
+void mi_get_mem_cache_stats(mi_h *h, unsigned long *hits,
+                            unsigned long *misses)
+{
+ mi_mem_cache *c=h->mcache;
+
+ if (hits)
+    *hits=c ? c->hits : 0;
+ if (misses)
+    *misses=c ? c->misses : 0;
+}
+
+/* Function calls, assignments, increments and decrements can change the
+   memory. A '(' after a name is a call, casts are harmless. */
+static
+int mi_exp_has_side_effects(const char *s)
+{
+ char prev=0;
+
+ for (; *s && *s!='\n'; s++)
+    {
+     if (*s=='=')
+       {
+        if (s[1]=='=')
+           s++;
+        else if (!prev || !strchr("=!<>",prev))
+           return 1;
+       }
+     else if ((*s=='+' || *s=='-') && s[1]==*s)
+        return 1;
+     else if (*s=='(' && prev && (isalnum((unsigned char)prev) ||
+              prev=='_' || prev==')' || prev==']'))
+        return 1;
+     if (*s!=' ')
+        prev=*s;
+    }
+ return 0;
+}
+
+/* Commands that can change the memory of the target. */
+static const char *mi_mem_cmds[]=
+{
+ "-exec-", "-data-write-", "-var-assign", "-target-", "-interpreter-exec",
+ "-gdb-set", "-file-", NULL
+};
+
+/* Called for each command we send to gdb, flushes the cache if the command
+   can change the target. */
+void mi_mem_cache_cmd(mi_h *h, const char *cmd)
+{
+ int i;
+
+ if (!h->mcache || !h->mcache->npages)
+    return;
+ cmd=mi_cmd_name(cmd);
+ if (isalpha((unsigned char)*cmd))
+   {/* CLI command, only a few are known to be harmless. */
+    if (strncmp(cmd,"show ",5) && strncmp(cmd,"info ",5) &&
+        strncmp(cmd,"frame",5) && strncmp(cmd,"find ",5))
+       mi_mem_cache_invalidate(h);
+    return;
+   }
+ /* Things like the register numbers sent by parts. */
+ if (*cmd!='-')
+    return;
+ for (i=0; mi_mem_cmds[i]; i++)
+     if (strncmp(cmd,mi_mem_cmds[i],strlen(mi_mem_cmds[i]))==0)
+       {
+        mi_mem_cache_invalidate(h);
+        return;
+       }
+ if (strncmp(cmd,"-data-evaluate-expression",25)==0 &&
+     mi_exp_has_side_effects(cmd+25))
+    mi_mem_cache_invalidate(h);
+}
+
+static
+mi_mem_page *mi_mem_cache_find(mi_mem_cache *c, unsigned long addr)
+{
+ mi_mem_page *p=c->pages[mi_mem_hash(c,addr)];
+
+ while (p && p->addr!=addr)
+    p=p->next;
+ return p;
+}
+
+static
+void mi_mem_cache_add(mi_h *h, unsigned long addr, const unsigned char *data)
+{
+ mi_mem_cache *c=h->mcache;
+ mi_mem_page *p;
+ int i;
+
+ if (c->npages>=c->max_pages)
+    mi_mem_cache_invalidate(h);
+ if (data)
+   {
+    p=(mi_mem_page *)mi_malloc(offsetof(mi_mem_page,data)+MI_MEM_PAGE);
+    if (!p)
+       return;
+    memcpy(p->data,data,MI_MEM_PAGE);
+   }
+ else
+   {
+    p=(mi_mem_page *)mi_malloc(sizeof(mi_mem_page));
+    if (!p)
+       return;
+   }
+ p->addr=addr;
+ p->readable=data!=NULL;
+ i=mi_mem_hash(c,addr);
+ p->next=c->pages[i];
+ c->pages[i]=p;
+ c->npages++;
+}
+
+/* Copies the part of [b,e) inside [addr,end) to dest. */
+static
+long mi_mem_cache_copy(unsigned long b, unsigned long e,
+                       const unsigned char *src, unsigned long addr,
+                       unsigned long end, unsigned char *dest,
+                       mi_mem_region **regions)
+{
+ unsigned long s=b<addr ? addr : b;
+
+ if (e>end)
+    e=end;
+ if (s>=e)
+    return 0;
+ memcpy(dest+(s-addr),src+(s-b),e-s);
+ if (regions && !mi_add_mem_region(regions,s,e))
+    return -1;
+ return e-s;
+}
+
+/* Reads the pages [start,stop) from gdb, copies what was requested and
+   caches the pages that are fully readable or fully unreadable. */
+static
+long mi_mem_cache_fill(mi_h *h, unsigned long start, unsigned long stop,
+                       unsigned long addr, unsigned long end,
+                       unsigned char *dest, mi_mem_region **regions)
+{
+ unsigned char *buf=(unsigned char *)mi_malloc(stop-start);
+ mi_mem_region *reg=NULL, *r;
+ unsigned long pa;
+ long total=0, n;
+
+ if (!buf)
+    return -1;
+ if (mi_read_memory_bytes(h,start,stop-start,buf,&reg)<0)
+   {
+    free(buf);
+    return -1;
+   }
+ for (r=reg; r; r=r->next)
+    {
+     n=mi_mem_cache_copy(r->start,r->end,buf+(r->start-start),addr,end,dest,
+                         regions);
+     if (n<0)
+       {
+        total=-1;
+        break;
+       }
+     total+=n;
+    }
+ /* The regions are sorted, walk them with the pages. */
+ for (pa=start, r=reg; total>=0 && pa<stop; pa+=MI_MEM_PAGE)
+    {
+     while (r && r->end<=pa)
+        r=r->next;
+     if (!r || r->start>=pa+MI_MEM_PAGE)
+        mi_mem_cache_add(h,pa,NULL);
+     else if (r->start<=pa && r->end>=pa+MI_MEM_PAGE)
+        mi_mem_cache_add(h,pa,buf+(pa-start));
+    }
+ mi_free_mem_region(reg);
+ free(buf);
+ return total;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Reads @var{size} bytes at @var{addr} using the memory cache. Pages
+missing from the cache are requested to gdb using
+@x{gmi_read_memory_bytes}, contiguous pages are requested together. The
+arguments and the returned regions are the same used by
+@x{gmi_read_memory_bytes}.
+
+  Return: The number of bytes read or -1 on error.
+
+***************************************************************************/
+
+long mi_mem_cache_read(mi_h *h, unsigned long addr, unsigned long size,
+                       unsigned char *dest, mi_mem_region **regions)
+{
+ mi_mem_cache *c=h->mcache;
+ mi_mem_page *p;
+ unsigned long end=addr+size, pa, miss=0;
+ long total=0, n;
+ int in_miss=0;
+
+ if (regions)
+    *regions=NULL;
+ if (!c)
+    return mi_read_memory_bytes(h,addr,size,dest,regions);
+ for (pa=addr & ~PAGE_MASK; pa<end; pa+=MI_MEM_PAGE)
+    {
+     p=mi_mem_cache_find(c,pa);
+     if (!p)
+       {
+        c->misses++;
+        if (!in_miss)
+          {
+           in_miss=1;
+           miss=pa;
+          }
+        continue;
+       }
+     c->hits++;
+     if (in_miss)
+       {
+        n=mi_mem_cache_fill(h,miss,pa,addr,end,dest,regions);
+        if (n<0)
+           goto error;
+        total+=n;
+        in_miss=0;
+        /* Filling could flush the cache. */
+        p=mi_mem_cache_find(c,pa);
+        if (!p)
+          {
+           in_miss=1;
+           miss=pa;
+           continue;
+          }
+       }
+     if (p->readable)
+       {
+        n=mi_mem_cache_copy(pa,pa+MI_MEM_PAGE,p->data,addr,end,dest,regions);
+        if (n<0)
+           goto error;
+        total+=n;
+       }
+    }
+ if (in_miss)
+   {
+    n=mi_mem_cache_fill(h,miss,pa,addr,end,dest,regions);
+    if (n<0)
+       goto error;
+    total+=n;
+   }
+ return total;
+
+error:
+ if (regions)
+   {
+    mi_free_mem_region(*regions);
+    *regions=NULL;
+   }
+ return -1;
+}
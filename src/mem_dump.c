@@ -0,0 +1,317 @@
+/**[txh]********************************************************************
+
+  GDB/MI interface library
+  Copyright (c) 2004-2016 by Salvador E. Tropea.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+  Module: Memory dump.
+  Comments:
+  Streams ranges of the target memory to a file. The memory is requested
+in chunks using -data-read-memory-bytes, a few chunks are in flight at the
+same time, and each chunk is written to the file as soon as it arrives.
+So the memory used doesn't depend on the size of the ranges.@p
+  The file starts with an index, all the numbers are 64 bits little
+endian:@p
+
+@<pre>
+Offset  Size         Contents
+0       8            "MIGDBDMP"
+8       4            Version (1), 32 bits
+12      4            Number of ranges (N), 32 bits
+16      32*N         One entry for each range:
+                     start address, size, bytes already dumped (done),
+                     bytes gdb could read (readable)
+16+32*N              The contents of the ranges, one after the other
+@</pre>
+
+  The parts gdb can't read are filled with zeros. The done field is
+updated after writing each chunk, so an interrupted dump can be resumed.@p
+
+***************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include "mi_gdb.h"
+
+#define MI_DUMP_MAGIC   "MIGDBDMP"
+#define MI_DUMP_VERSION 1
+#define MI_DUMP_HEADER  16
+#define MI_DUMP_ENTRY   32
+/* Size of the requests and how many are in flight. The buffer used is
+   the product. */
+#define MI_DUMP_CHUNK   65536
+#define MI_DUMP_WINDOW  8
+
+typedef struct
+{
+ unsigned long start, size, done, readable;
+ /* Position of the contents in the file. */
+ off_t offset;
+} mi_dump_range;
+
+static
+void mi_put64(unsigned char *d, uint64_t v)
+{
+ int i;
+ for (i=0; i<8; i++, v>>=8)
+     d[i]=v & 0xFF;
+}
+
+static
+uint64_t mi_get64(const unsigned char *s)
+{
+ uint64_t v=0;
+ int i;
+ for (i=7; i>=0; i--)
+     v=v<<8 | s[i];
+ return v;
+}
+
+static
+int mi_write_at(int fd, const void *buf, size_t len, off_t off)
+{
+ ssize_t w;
+
+ while (len)
+   {
+    w=TEMP_FAILURE_RETRY(pwrite(fd,buf,len,off));
+    if (w<=0)
+      {
+       mi_error=MI_FILE_IO;
+       return 0;
+      }
+    buf=(const char *)buf+w;
+    len-=w;
+    off+=w;
+   }
+ return 1;
+}
+
+static
+int mi_dump_entry(int fd, mi_dump_range *r, int i)
+{
+ unsigned char e[MI_DUMP_ENTRY];
+
+ mi_put64(e,r->start);
+ mi_put64(e+8,r->size);
+ mi_put64(e+16,r->done);
+ mi_put64(e+24,r->readable);
+ return mi_write_at(fd,e,MI_DUMP_ENTRY,MI_DUMP_HEADER+i*MI_DUMP_ENTRY);
+}
+
+/* Writes a new index, nothing dumped. */
+static
+int mi_dump_index(int fd, mi_dump_range *r, int count)
+{
+ unsigned char hd[MI_DUMP_HEADER];
+ int i;
+
+ if (ftruncate(fd,0) && errno!=EINVAL)
+   {
+    mi_error=MI_FILE_IO;
+    return 0;
+   }
+ memcpy(hd,MI_DUMP_MAGIC,8);
+ hd[8]=MI_DUMP_VERSION;
+ hd[9]=hd[10]=hd[11]=0;
+ hd[12]=count & 0xFF;
+ hd[13]=(count>>8) & 0xFF;
+ hd[14]=(count>>16) & 0xFF;
+ hd[15]=(count>>24) & 0xFF;
+ if (!mi_write_at(fd,hd,MI_DUMP_HEADER,0))
+    return 0;
+ for (i=0; i<count; i++)
+     if (!mi_dump_entry(fd,r+i,i))
+        return 0;
+ return 1;
+}
+
+/* Loads the progress of a previous dump of the same ranges. */
+static
+int mi_dump_load(int fd, mi_dump_range *r, int count)
+{
+ unsigned char hd[MI_DUMP_HEADER], e[MI_DUMP_ENTRY];
+ int i;
+
+ if (TEMP_FAILURE_RETRY(pread(fd,hd,MI_DUMP_HEADER,0))!=MI_DUMP_HEADER ||
+     memcmp(hd,MI_DUMP_MAGIC,8) || hd[8]!=MI_DUMP_VERSION ||
+     (hd[12] | hd[13]<<8 | hd[14]<<16 | (unsigned)hd[15]<<24)!=(unsigned)count)
+    return 0;
+ for (i=0; i<count; i++)
+    {
+     if (TEMP_FAILURE_RETRY(pread(fd,e,MI_DUMP_ENTRY,MI_DUMP_HEADER+
+         i*MI_DUMP_ENTRY))!=MI_DUMP_ENTRY ||
+         mi_get64(e)!=r[i].start || mi_get64(e+8)!=r[i].size ||
+         mi_get64(e+16)>r[i].size)
+       {/* Not the same ranges, start again. */
+        for (i=0; i<count; i++)
+            r[i].done=r[i].readable=0;
+        return 0;
+       }
+     r[i].done=mi_get64(e+16);
+     r[i].readable=mi_get64(e+24);
+    }
+ return 1;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Dumps the memory @var{ranges} ([start,end) each) to @var{fd}, the format
+is described in the module comments. The file descriptor must be seekable
+and opened for reading and writing. Only a small buffer is used, the
+contents go directly from gdb to the file.@p
+  If @var{resume} is !=0 and @var{fd} contains an interrupted dump of the
+same ranges it's continued, otherwise the file is truncated and a new dump
+is started.
+
+  Command: -data-read-memory-bytes
+  Return: The number of bytes gdb could read in this call or -1 on error.
+What was dumped before the error is kept and can be resumed.
+
+***************************************************************************/
+
+long gmi_dump_memory_regions(mi_h *h, mi_mem_region *ranges, int fd,
+                             int resume)
+{
+ int tk[MI_DUMP_WINDOW], ri[MI_DUMP_WINDOW];
+ unsigned long off[MI_DUMP_WINDOW], len[MI_DUMP_WINDOW];
+ mi_dump_range *r;
+ mi_mem_region *p;
+ unsigned char *buf, *b;
+ unsigned long pos;
+ int count=0, i, cur, sent=0, done=0, err=0, slot;
+ off_t data;
+ long total=0, n;
+ mi_output *o;
+
+ for (p=ranges; p; p=p->next)
+     count++;
+ r=(mi_dump_range *)mi_calloc(count ? count : 1,sizeof(mi_dump_range));
+ buf=(unsigned char *)mi_malloc(MI_DUMP_WINDOW*MI_DUMP_CHUNK);
+ if (!r || !buf)
+   {
+    free(r);
+    free(buf);
+    return -1;
+   }
+ data=MI_DUMP_HEADER+count*MI_DUMP_ENTRY;
+ for (p=ranges, i=0; p; p=p->next, i++)
+    {
+     r[i].start=p->start;
+     r[i].size=p->end>p->start ? p->end-p->start : 0;
+     r[i].offset=data;
+     data+=r[i].size;
+    }
+ if ((!resume || !mi_dump_load(fd,r,count)) && !mi_dump_index(fd,r,count))
+   {
+    free(r);
+    free(buf);
+    return -1;
+   }
+
+ cur=0;
+ pos=count ? r[0].done : 0;
+ while (1)
+   {
+    /* Keep the window full. */
+    while (!err && sent-done<MI_DUMP_WINDOW)
+      {
+       while (cur<count && pos>=r[cur].size)
+         {
+          if (++cur<count)
+             pos=r[cur].done;
+         }
+       if (cur>=count)
+          break;
+       slot=sent%MI_DUMP_WINDOW;
+       len[slot]=r[cur].size-pos<MI_DUMP_CHUNK ? r[cur].size-pos :
+                 MI_DUMP_CHUNK;
+       tk[slot]=mi_data_read_memory_bytes_tk(h,r[cur].start+pos,len[slot]);
+       if (!tk[slot])
+         {
+          err=1;
+          break;
+         }
+       ri[slot]=cur;
+       off[slot]=pos;
+       pos+=len[slot];
+       sent++;
+      }
+    if (done==sent)
+       break;
+    slot=done%MI_DUMP_WINDOW;
+    o=mi_get_response_tk(h,tk[slot]);
+    if (!err)
+      {/* The chunks arrive in order, so done only grows. */
+       i=ri[slot];
+       b=buf+slot*MI_DUMP_CHUNK;
+       memset(b,0,len[slot]);
+       n=o ? mi_get_read_memory_bytes(o,r[i].start+off[slot],len[slot],b,NULL)
+           : -1;
+       if (n<0 || !mi_write_at(fd,b,len[slot],r[i].offset+off[slot]))
+          err=1;
+       else
+         {
+          r[i].done=off[slot]+len[slot];
+          r[i].readable+=n;
+          total+=n;
+          if (!mi_dump_entry(fd,r+i,i))
+             err=1;
+         }
+      }
+    mi_free_output(o);
+    done++;
+   }
+ free(r);
+ free(buf);
+ return err ? -1 : total;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Same as @x{gmi_dump_memory_regions}, but using a file name. The file is
+created if needed.
+
+  Command: -data-read-memory-bytes
+  Return: The number of bytes gdb could read in this call or -1 on error.
+
+***************************************************************************/
+
+long gmi_dump_memory_regions_f(mi_h *h, mi_mem_region *ranges,
+                               const char *file, int resume)
+{
+ long ret;
+ int fd=open(file,O_RDWR | O_CREAT,0644);
+
+ if (fd<0)
+   {
+    mi_error=MI_FILE_IO;
+    return -1;
+   }
+ ret=gmi_dump_memory_regions(h,ranges,fd,resume);
+ if (close(fd) && ret>=0)
+   {
+    mi_error=MI_FILE_IO;
+    ret=-1;
+   }
+ return ret;
+}
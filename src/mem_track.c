@@ -0,0 +1,271 @@
+/**[txh]********************************************************************
+
+  GDB/MI interface library
+  Copyright (c) 2004-2016 by Salvador E. Tropea.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+  Module: Memory tracking.
+  Comments:
+  Ranges of the target memory compared from one stop to the next. The
+ranges are registered using @x{mi_track_memory}, when the program stops
+(mi_res_stop or MIDebugger::Poll) they are read and compared with the
+contents at the previous stop. The changed spans are collected using
+@x{mi_get_memory_changes}.@p
+  All the ranges are requested at once, so the round trip is paid only
+once. Parts that gdb can't read are compared as zeros.@p
+
+***************************************************************************/
+
+#include <string.h>
+#include "mi_gdb.h"
+
+#define MI_TRACK_CHUNK 65536
+/* Changes separated by less than this number of equal bytes are reported
+   as one span. */
+#define MI_TRACK_GAP   8
+
+/**[txh]********************************************************************
+
+  Description:
+  Adds [@var{start},@var{end}) to the memory ranges compared at each stop.
+The first stop after it just takes the initial contents.
+
+  Return: !=0 OK.
+
+***************************************************************************/
+
+int mi_track_memory(mi_h *h, unsigned long start, unsigned long end)
+{
+ mi_mem_track *t, **p;
+
+ if (end<=start)
+    return 0;
+ t=(mi_mem_track *)mi_calloc1(sizeof(mi_mem_track));
+ if (!t)
+    return 0;
+ t->snap=(unsigned char *)mi_malloc(end-start);
+ t->new_snap=(unsigned char *)mi_malloc(end-start);
+ if (!t->snap || !t->new_snap)
+   {
+    free(t->snap);
+    free(t->new_snap);
+    free(t);
+    return 0;
+   }
+ t->start=start;
+ t->end=end;
+ /* Keep the order, the changes are reported in the same order. */
+ for (p=&h->mtrack; *p; p=&(*p)->next);
+ *p=t;
+ return 1;
+}
+
+static
+void mi_free_mem_track(mi_mem_track *t)
+{
+ free(t->snap);
+ free(t->new_snap);
+ free(t);
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Stops tracking the range starting at @var{start}.
+
+  Return: !=0 if the range was tracked.
+
+***************************************************************************/
+
+int mi_untrack_memory(mi_h *h, unsigned long start)
+{
+ mi_mem_track *t, **p;
+
+ for (p=&h->mtrack; *p; p=&(*p)->next)
+     if ((*p)->start==start)
+       {
+        t=*p;
+        *p=t->next;
+        mi_free_mem_track(t);
+        return 1;
+       }
+ return 0;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Stops tracking all the ranges and discards the changes not yet collected.
+
+***************************************************************************/
+
+void mi_clear_tracked_memory(mi_h *h)
+{
+ mi_mem_track *t;
+
+ while (h->mtrack)
+   {
+    t=h->mtrack;
+    h->mtrack=t->next;
+    mi_free_mem_track(t);
+   }
+ mi_free_mem_region(h->mchanges);
+ h->mchanges=NULL;
+}
+
+/* Adds the spans that differ between snap and new_snap to the list, tail
+   is where the next span goes. */
+static
+int mi_track_diff(mi_mem_track *t, mi_mem_region **tail)
+{
+ const unsigned char *a=t->snap, *b=t->new_snap;
+ size_t n=t->end-t->start, i=0, first, last, eq;
+ mi_mem_region *r;
+ int spans=0;
+
+ while (1)
+   {
+    i+=mi_mem_diff(a+i,b+i,n-i);
+    if (i>=n)
+       break;
+    /* The span ends after MI_TRACK_GAP equal bytes. */
+    for (first=last=i, eq=0, i++; i<n && eq<MI_TRACK_GAP; i++)
+       {
+        if (a[i]==b[i])
+           eq++;
+        else
+          {
+           last=i;
+           eq=0;
+          }
+       }
+    r=mi_alloc_mem_region();
+    if (!r)
+       return -1;
+    r->start=t->start+first;
+    r->end=t->start+last+1;
+    *tail=r;
+    tail=&r->next;
+    spans++;
+   }
+ return spans;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Reads the tracked ranges and compares them with the previous contents.
+The changed spans replace the ones not yet collected. Called by
+mi_res_stop, so you only need it if you don't use mi_res_stop.
+
+  Command: -data-read-memory-bytes
+  Return: The number of changed spans or -1 on error.
+
+***************************************************************************/
+
+int gmi_update_tracked_memory(mi_h *h)
+{
+ mi_mem_track *t;
+ mi_mem_region *changes=NULL, **tail=&changes;
+ int *tk, nchunks=0, i=0, spans=0, n, err=0;
+ unsigned long off, len;
+ mi_output *o;
+
+ for (t=h->mtrack; t; t=t->next)
+     nchunks+=(t->end-t->start+MI_TRACK_CHUNK-1)/MI_TRACK_CHUNK;
+ if (!nchunks)
+    return 0;
+ tk=(int *)mi_calloc(nchunks,sizeof(int));
+ if (!tk)
+    return -1;
+ /* Ask for all of them before waiting. */
+ for (t=h->mtrack; t && !err; t=t->next)
+     for (off=0; off<t->end-t->start; off+=MI_TRACK_CHUNK, i++)
+        {
+         len=t->end-t->start-off;
+         if (len>MI_TRACK_CHUNK)
+            len=MI_TRACK_CHUNK;
+         tk[i]=mi_data_read_memory_bytes_tk(h,t->start+off,len);
+         if (!tk[i])
+           {
+            err=1;
+            break;
+           }
+        }
+ for (t=h->mtrack, i=0; t; t=t->next)
+    {
+     memset(t->new_snap,0,t->end-t->start);
+     for (off=0; off<t->end-t->start; off+=MI_TRACK_CHUNK, i++)
+        {
+         if (!tk[i])
+            continue;
+         len=t->end-t->start-off;
+         if (len>MI_TRACK_CHUNK)
+            len=MI_TRACK_CHUNK;
+         o=mi_get_response_tk(h,tk[i]);
+         if (!o || mi_get_read_memory_bytes(o,t->start+off,len,
+             t->new_snap+off,NULL)<0)
+            err=1;
+         mi_free_output(o);
+        }
+    }
+ free(tk);
+ if (err)
+    return -1;
+
+ for (t=h->mtrack; t; t=t->next)
+    {
+     unsigned char *aux;
+     if (t->valid)
+       {
+        n=mi_track_diff(t,tail);
+        if (n<0)
+          {
+           mi_free_mem_region(changes);
+           return -1;
+          }
+        spans+=n;
+        while (*tail)
+           tail=&(*tail)->next;
+       }
+     aux=t->snap;
+     t->snap=t->new_snap;
+     t->new_snap=aux;
+     t->valid=1;
+    }
+ mi_free_mem_region(h->mchanges);
+ h->mchanges=changes;
+ return spans;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Returns the spans of the tracked memory that changed at the last stop.
+The list belongs to the caller, release it using mi_free_mem_region. The
+next call returns NULL until the next stop.
+
+  Return: The list of changed spans, NULL if none.
+
+***************************************************************************/
+
+mi_mem_region *mi_get_memory_changes(mi_h *h)
+{
+ mi_mem_region *r=h->mchanges;
+
+ h->mchanges=NULL;
+ return r;
+}
@@ -44,7 +44,8 @@ extern "C" {
 #define MI_MISSING_XTERM          11
 #define MI_CREATE_TEMPORAL        12
 #define MI_MISSING_GDB            13
-#define MI_LAST_ERROR             13
+#define MI_FILE_IO                14
+#define MI_LAST_ERROR             14
 
 #define MI_R_NONE                  0 /* We are no waiting any response. */
 #define MI_R_SKIP                  1 /* We want to discard it. */
@@ -79,6 +80,10 @@ enum mi_val_type { t_const, t_tuple, t_list };
 #define MI_CL_CONNECTED    4
 #define MI_CL_ERROR        5
 #define MI_CL_EXIT         6
+/* Notifications (MI_SST_NOTIFY). */
+#define MI_CL_BKPT_CREATED  7
+#define MI_CL_BKPT_MODIFIED 8
+#define MI_CL_BKPT_DELETED  9
 
 #define MI_DEFAULT_TIME_OUT 10
 
@@ -95,10 +100,33 @@ enum mi_val_type { t_const, t_tuple, t_list };
 #define MI_VERSION_MIDDLE 8
 #define MI_VERSION_MINOR  13
 
+/* Known result names, the parser assigns them to mi_results.atom so the
+   decoders don't need strcmp. */
+enum mi_atom
+{
+ at_unknown=0, at_addr, at_address, at_args, at_asm_insns, at_attr, at_begin,
+ at_bkpt, at_bkptno, at_changed_registers, at_changelist, at_child,
+ at_children, at_cond, at_contents, at_data, at_depth, at_disp, at_enabled,
+ at_end, at_exit_code, at_exp, at_file, at_format, at_frame, at_from,
+ at_fullname, at_func, at_func_name, at_gdb_result_var, at_hw_awpt,
+ at_hw_rwpt, at_ignore, at_in_scope, at_inst, at_lang, at_level, at_line,
+ at_line_asm_insn, at_locals, at_memory, at_msg, at_name, at_new,
+ at_new_num_children, at_new_type, at_number, at_number_of_threads,
+ at_numchild, at_offset, at_old, at_reason, at_register_names,
+ at_register_values, at_return_value, at_signal_meaning, at_signal_name,
+ at_src_and_asm_line, at_stack, at_thread_id, at_thread_ids, at_times,
+ at_type, at_value, at_wpnum, at_wpt,
+ /* Number of atoms. */
+ at_last
+};
+
 struct mi_results_struct
 {
  char *var; /* Result name or NULL if just a value. */
  enum mi_val_type type;
+ char arena; /* Allocated from the arena of the record (see mi_set_arena). */
+ unsigned char atom; /* enum mi_atom for var, at_unknown if not a known one. */
+ unsigned char array; /* 1 if it's an element of a mi_rs_array, 2 for the first. */
  union
  {
   char *cstr;
@@ -108,6 +136,28 @@ struct mi_results_struct
 };
 typedef struct mi_results_struct mi_results;
 
+/* With arenas the elements of each tuple and list are stored in one block.
+   They are still linked using next. */
+struct mi_rs_array_struct
+{
+ int count;
+ /* Position+1 of the first element for each atom, NULL if not indexed. */
+ unsigned char *index;
+ mi_results items[1];
+};
+typedef struct mi_rs_array_struct mi_rs_array;
+
+/* Slabs used to parse one record, they are released all at once. */
+struct mi_arena_struct
+{
+ /* Free space in the current slab. */
+ char *pos, *end;
+ void *slabs;
+ /* The mi_output or mi_results that releases the arena. */
+ void *owner;
+};
+typedef struct mi_arena_struct mi_arena;
+
 struct mi_output_struct
 {
  /* Type of output. */
@@ -115,16 +165,183 @@ struct mi_output_struct
  char stype;
  char sstype;
  char tclass;
+ /* Token that prefixed the record, 0 if none. */
+ int token;
  /* Content. */
  mi_results *c;
+ /* Memory for this record, NULL if the nodes are malloc'ed. */
+ mi_arena *arena;
  /* Always modeled as a list. */
  struct mi_output_struct *next;
 };
 typedef struct mi_output_struct mi_output;
 
+/* Events reported by the event parser (mi_parse_gdb_output_ev). */
+enum mi_event_type { ev_tuple, ev_list, ev_end, ev_value };
+
+struct mi_event_struct
+{
+ enum mi_event_type type;
+ /* Result name, NULL for list elements. ev_end repeats the ones of the
+    tuple/list. */
+ const char *var;
+ enum mi_atom atom;
+ /* ev_value: the unescaped string and its length. */
+ const char *val;
+ int len;
+ /* Nesting level, 0 for the results of the record. */
+ int depth;
+};
+typedef struct mi_event_struct mi_event;
+
 typedef void (*stream_cb)(const char *, void *);
 typedef void (*async_cb)(mi_output *o, void *);
 typedef int  (*tm_cb)(void *);
+/* Completion for mi_submit, receives the answer (NULL on error). */
+typedef void (*done_cb)(mi_output *o, void *);
+typedef void (*event_cb)(mi_event *e, void *);
+/* Receives what we collected at a hit (see mi_set_auto_continue). */
+struct mi_hit_struct;
+typedef void (*hit_cb)(struct mi_hit_struct *hit, void *);
+
+/* A command sent with a token (mi_send_tk) that is waiting for its result.
+   Also used to queue regular responses completed while we waited for a
+   token, they have token 0. */
+struct mi_pending_struct
+{
+ int token;
+ /* The result record, NULL until gdb answers. */
+ mi_output *o;
+ /* Completion callback, only for mi_submit. */
+ done_cb cb;
+ void *cb_data;
+ struct mi_pending_struct *next;
+};
+typedef struct mi_pending_struct mi_pending;
+
+/* Tuple or list the incremental parser is filling. */
+struct mi_inc_level_struct
+{
+ /* Where the next element goes. */
+ mi_results **tail;
+ char close;
+};
+typedef struct mi_inc_level_struct mi_inc_level;
+
+/* State of the incremental parser (mi_inc_feed). */
+struct mi_inc_struct
+{
+ int state;
+ int token;
+ /* Some bytes of the current line were consumed. */
+ char in_line;
+ /* The line was a (gdb) prompt. */
+ char prompt;
+ /* The record we are building and the node that gets the next value. */
+ mi_output *o;
+ mi_results *cur;
+ /* Nesting, level 0 are the results of the record. */
+ mi_inc_level *levels;
+ int depth, max_depth;
+ /* Header, key or string we are collecting. */
+ char *buf;
+ int len, size;
+ unsigned hash;
+ /* Octal escape we are decoding. */
+ int esc, esc_len;
+};
+typedef struct mi_inc_struct mi_inc;
+
+/* Size of the pages kept by the memory cache. */
+#define MI_MEM_PAGE 4096
+
+/* A page of target memory, data is only allocated for readable pages. */
+struct mi_mem_page_struct
+{
+ unsigned long addr;
+ char readable;
+ struct mi_mem_page_struct *next;
+ unsigned char data[1];
+};
+typedef struct mi_mem_page_struct mi_mem_page;
+
+/* Target memory cache (see mi_set_mem_cache). */
+struct mi_mem_cache_struct
+{
+ /* Hash table of pages, indexed by page number. */
+ mi_mem_page **pages;
+ int hash_size;
+ int npages, max_pages;
+ unsigned long hits, misses;
+};
+typedef struct mi_mem_cache_struct mi_mem_cache;
+
+/* Range watched by mi_track_memory. snap has the contents at the last
+   stop, new is used to read the next one. */
+struct mi_mem_track_struct
+{
+ unsigned long start, end;
+ unsigned char *snap, *new_snap;
+ char valid;
+ struct mi_mem_track_struct *next;
+};
+typedef struct mi_mem_track_struct mi_mem_track;
+
+/* Register file of the target (see mi_set_reg_cache). The arrays are
+   indexed by register number. */
+struct mi_reg_cache_struct
+{
+ int count;
+ /* NULL until fetched, fetched again when the target could change. */
+ char **names;
+ /* Value at the last stop, NULL if unknown. */
+ char **values;
+ /* Changed at the last stop. */
+ unsigned char *changed;
+ /* Format for the values (enum mi_gvar_fmt). */
+ int fmt;
+ /* The target is running, the values are from the previous stop. */
+ char stale;
+};
+typedef struct mi_reg_cache_struct mi_reg_cache;
+
+/* Disassembly stored by the disassembly cache. key and data point to the
+   mapped file for entries loaded from it. */
+struct mi_disasm_entry_struct
+{
+ /* Object, range and mode. */
+ const char *key;
+ /* Serialized instructions. */
+ const unsigned char *data;
+ size_t size;
+ /* Entries in the file, key and data are offsets in the map. */
+ char mapped;
+ off_t koff, doff;
+ struct mi_disasm_entry_struct *next;
+};
+typedef struct mi_disasm_entry_struct mi_disasm_entry;
+
+/* Disassembly cache (see mi_set_disasm_cache). */
+struct mi_disasm_cache_struct
+{
+ mi_disasm_entry **hash;
+ /* Entries in the file, not limited. */
+ mi_disasm_entry **findex;
+ int hash_size;
+ int count, max;
+ /* Build-id or file+mtime of the object, nothing is cached without it. */
+ char *obj;
+ /* Start and end of its executable segments, only code there is cached. */
+ unsigned long *text;
+ int ntext;
+ /* File used to keep the entries between sessions, -1 if none. */
+ int fd;
+ void *map;
+ size_t map_size;
+ off_t end;
+ unsigned long hits, misses;
+};
+typedef struct mi_disasm_cache_struct mi_disasm_cache;
 
 /* Values of this structure shouldn't be manipulated by the user. */
 struct mi_h_struct
@@ -142,8 +359,43 @@ struct mi_h_struct
  /* The line we are reading. */
  char *line;
  int   llen, lread;
+ /* Copy of the line for from_gdb_echo when using the incremental parser. */
+ char *echo;
+ int   elen, eread;
+ /* Input buffer, filled with big reads and consumed by mi_getline. */
+ char *rbuf;
+ int   rsize, rpos, rend;
  /* Parsed output. */
  mi_output *po, *last;
+ /* Commands sent with a token, in the order they were sent. */
+ mi_pending *pend, *pend_last;
+ int last_token;
+ int in_flight;     /* Sent but not yet answered. */
+ int skip_prompts;  /* Prompts that belong to answers already matched. */
+ char resp_ready;   /* mi_process_input found a complete response. */
+ /* Regular responses completed while waiting for a token, oldest first. */
+ mi_pending *ready, *ready_last;
+ char use_arena;    /* Parse each record using an arena. */
+ /* Incremental parser, NULL if we parse complete lines. */
+ mi_inc *inc;
+ /* Target memory cache, NULL if disabled. */
+ mi_mem_cache *mcache;
+ /* Memory compared at each stop and the changes found. */
+ mi_mem_track *mtrack;
+ struct mi_mem_region_struct *mchanges;
+ /* Register cache, NULL if disabled. */
+ mi_reg_cache *rcache;
+ /* Size in bytes of each register, NULL until loaded. */
+ int *reg_sizes;
+ int nreg_sizes;
+ /* Disassembly cache, NULL if disabled. */
+ mi_disasm_cache *dcache;
+ /* Breakpoints of the session, NULL if disabled. */
+ struct mi_bkpt_table_struct *btable;
+ /* Events printed by our dprintf probes, NULL if disabled. */
+ struct mi_dprintf_struct *dprintf;
+ /* Breakpoints handled by the library, NULL if none. */
+ struct mi_autocont_struct *autocont;
  /* Tunneled streams callbacks. */
  stream_cb console;
  void *console_data;
@@ -154,6 +406,12 @@ struct mi_h_struct
  /* Async responses callback. */
  async_cb async;
  void *async_data;
+ /* Hits of the auto-continue breakpoints. */
+ hit_cb hit;
+ void *hit_data;
+ /* Results of ^done records as events, instead of a tree. */
+ event_cb event;
+ void *event_data;
  /* Callbacks to get echo of gdb dialog. */
  stream_cb to_gdb_echo;
  void *to_gdb_echo_data;
@@ -168,10 +426,41 @@ struct mi_h_struct
  char *catched_console;
  /* MI version, currently unknown but the user can force v2 */
  unsigned version;
+ /* When driven by a reactor. */
+ struct mi_session_struct *session;
 };
 typedef struct mi_h_struct mi_h;
 
 #define MI_TO(a) ((a)->to_gdb[1])
+#define MI_FROM(a) ((a)->from_gdb[0])
+
+/* Reactor: drives many gdb sessions from one thread (Linux only). */
+typedef void (*reactor_cb)(mi_h *h, mi_output *o, void *);
+
+struct mi_session_struct
+{
+ mi_h *h;
+ /* The reactor that drives it, used when the handle is released. */
+ struct mi_reactor_struct *reactor;
+ /* Called for each complete response, NULL when gdb dies. */
+ reactor_cb cb;
+ void *data;
+ char removed;
+ struct mi_session_struct *prev, *next;
+};
+typedef struct mi_session_struct mi_session;
+
+/* Values of this structure shouldn't be manipulated by the user. */
+struct mi_reactor_struct
+{
+ int epfd;
+ mi_session *first;
+ /* Sessions removed while dispatching, released later. */
+ mi_session *zombies;
+ /* Set while dispatching events. */
+ char busy;
+};
+typedef struct mi_reactor_struct mi_reactor;
 
 enum mi_bkp_type { t_unknown=0, t_breakpoint=1, t_hw=2 };
 enum mi_bkp_disp { d_unknown=0, d_keep=1, d_del=2 };
@@ -199,6 +488,125 @@ struct mi_bkpt_struct
 };
 typedef struct mi_bkpt_struct mi_bkpt;
 
+/* Breakpoint in the session table, linked in the hash tables. */
+struct mi_bkpt_node_struct
+{
+ mi_bkpt *b;
+ struct mi_bkpt_node_struct *next_addr, *next_line;
+};
+typedef struct mi_bkpt_node_struct mi_bkpt_node;
+
+/* Breakpoints of the session (see mi_set_bkpt_table). */
+struct mi_bkpt_table_struct
+{
+ /* Indexed by breakpoint number. */
+ mi_bkpt_node **num;
+ int num_size;
+ /* Hashed by address and by file name and line. */
+ mi_bkpt_node **addr, **line;
+ int hash_size;
+ int count;
+};
+typedef struct mi_bkpt_table_struct mi_bkpt_table;
+
+/* Result for each location of gmi_break_insert_l. */
+struct mi_bkpt_res_struct
+{
+ int number; /* 0 if the breakpoint wasn't inserted. */
+ int error;  /* MI_OK or why it failed (i.e. MI_FROM_GDB). */
+ void *addr;
+ int line;
+};
+typedef struct mi_bkpt_res_struct mi_bkpt_res;
+
+#define MI_DPRINTF_FIELDS 8
+#define MI_DPRINTF_TEXT   240
+
+/* Line printed by a dprintf probe (see mi_set_dprintf). */
+struct mi_dprintf_ev_struct
+{
+ int probe;                /* As returned by gmi_dprintf_insert. */
+ int nfields;
+ unsigned long long stamp; /* When we got it, CLOCK_MONOTONIC in ns. */
+ /* Offset of each field in text, they are NUL terminated. */
+ unsigned short field[MI_DPRINTF_FIELDS];
+ char text[MI_DPRINTF_TEXT];
+};
+typedef struct mi_dprintf_ev_struct mi_dprintf_ev;
+
+/* Probe inserted by gmi_dprintf_insert. */
+struct mi_dprintf_probe_struct
+{
+ int bkpt;    /* Breakpoint number, 0 if deleted. */
+ int nfields;
+};
+typedef struct mi_dprintf_probe_struct mi_dprintf_probe;
+
+/* Ring buffer for the dprintf events. */
+struct mi_dprintf_struct
+{
+ mi_dprintf_ev *ring;
+ unsigned size;
+ /* Events read and written since we started. */
+ unsigned long long first, next;
+ unsigned long lost;
+ /* Indexed by probe-1. */
+ mi_dprintf_probe *probes;
+ int nprobes;
+};
+typedef struct mi_dprintf_struct mi_dprintf;
+
+/* What to collect at each hit of an auto-continue breakpoint. */
+struct mi_collect_struct
+{
+ int nexps;
+ const char **exps;
+ int nframes;      /* Addresses of the innermost frames. */
+ int nregs;
+ const int *regs;  /* Register numbers, only for scalar registers. */
+};
+typedef struct mi_collect_struct mi_collect;
+
+/* What we collected at a hit, valid only during the hit_cb call. */
+struct mi_hit_struct
+{
+ int bkptno;
+ int thread_id;
+ void *addr;       /* Where it stopped. */
+ int resumed;      /* 0 if we failed to continue, the target is stopped. */
+ int nexps;
+ char **values;    /* NULL if the expression failed. */
+ int nframes;      /* Frames we got, up to the requested. */
+ void **frames;
+ int nregs;
+ unsigned long long *regs; /* In the order of mi_collect.regs. */
+};
+typedef struct mi_hit_struct mi_hit;
+
+/* Auto-continue breakpoint, with the commands ready to be sent. */
+struct mi_autocont_bkpt_struct
+{
+ int bkptno;
+ int nexps, nframes, nregs;
+ char **cmds;
+ int ncmds;
+ unsigned long hits;
+ struct mi_autocont_bkpt_struct *next;
+};
+typedef struct mi_autocont_bkpt_struct mi_autocont_bkpt;
+
+struct mi_ac_state_struct;
+
+struct mi_autocont_struct
+{
+ mi_autocont_bkpt *bkpts;
+ /* -exec-continue sent by us and its *running not yet seen. */
+ int resuming;
+ /* Hits waiting for their commands, see mi_autocont_flush. */
+ struct mi_ac_state_struct *stops, *stops_last;
+};
+typedef struct mi_autocont_struct mi_autocont;
+
 enum mi_wp_mode { wm_unknown=0, wm_write=1, wm_read=2, wm_rw=3 };
 
 struct mi_wp_struct
@@ -321,6 +729,30 @@ struct mi_asm_insns_struct
 };
 typedef struct mi_asm_insns_struct mi_asm_insns;
 
+/* Disassembly as arrays, all in one block (release it using free or
+   mi_free_asm_block). The strings are offsets in text, 0 is used when gdb
+   didn't report it. Each function and file name is stored once for each
+   run of instructions using it. */
+struct mi_asm_block_struct
+{
+ /* Instructions. */
+ int count;
+ unsigned long *addr;
+ unsigned *offset;
+ unsigned *func;
+ unsigned *inst;
+ /* Source lines (modes 1 and 3), the instructions of line i are
+    [first[i],first[i+1]). */
+ int nlines;
+ int *line;
+ unsigned *file;
+ int *first;
+ /* Pool for the strings. */
+ char *text;
+ size_t text_size;
+};
+typedef struct mi_asm_block_struct mi_asm_block;
+
 /* Changed register. */
 struct mi_chg_reg_struct
 {
@@ -333,6 +765,26 @@ struct mi_chg_reg_struct
 };
 typedef struct mi_chg_reg_struct mi_chg_reg;
 
+/* Readable range found by gmi_read_memory_bytes, [start,end). */
+struct mi_mem_region_struct
+{
+ unsigned long start, end;
+
+ struct mi_mem_region_struct *next;
+};
+typedef struct mi_mem_region_struct mi_mem_region;
+
+/* Block to write using gmi_write_memory_l, buf isn't released. */
+struct mi_mem_write_struct
+{
+ unsigned long addr;
+ const unsigned char *buf;
+ unsigned long len;
+
+ struct mi_mem_write_struct *next;
+};
+typedef struct mi_mem_write_struct mi_mem_write;
+
 /*
  Examining gdb sources and looking at docs I can see the following "stop"
 reasons:
@@ -421,6 +873,10 @@ void mi_send_target_commands(mi_h *h);
 mi_h *mi_connect_local();
 /* Close connection. You should ask gdb to quit first. */
 void  mi_disconnect(mi_h *h);
+/* Empty handle (no gdb, descriptors at -1) and its release. Used to attach
+   the library to descriptors created by the application. */
+mi_h *mi_alloc_h();
+void  mi_free_h(mi_h **handle);
 /* Force MI version. */
 #define MI_VERSION2U(maj,mid,min) (maj*0x1000000+mid*0x10000+min)
 void  mi_force_version(mi_h *h, unsigned vMajor, unsigned vMiddle,
@@ -429,6 +885,47 @@ void  mi_set_workaround(unsigned wa, int enable);
 int   mi_get_workaround(unsigned wa);
 /* Parse gdb output. */
 mi_output *mi_parse_gdb_output(const char *str);
+/* Atoms for result names. */
+enum mi_atom mi_atom_of(const char *var);
+const char *mi_atom_to_str(enum mi_atom a);
+/* The same, but all the record lives in one arena. */
+mi_output *mi_parse_gdb_output_arena(const char *str);
+/* The same, but the results of ^done are reported as events. */
+mi_output *mi_parse_gdb_output_ev(char *str, event_cb cb, void *data);
+/* Use arenas to parse the records. */
+void mi_set_arena(mi_h *h, int enable);
+/* Parse the records while they arrive, no need to wait for the whole line. */
+int mi_inc_feed(mi_inc *p, const char *s, int len, int *used);
+int mi_set_incremental(mi_h *h, int enable);
+/* Kernels used to scan c-strings (SSE2/AVX2 when available). */
+const char *mi_scan_cstr(const char *s);
+const char *mi_scan_line(const char *s, const char *e);
+const char *mi_scan_select(const char *name);
+int mi_hex_decode(unsigned char *d, const char *s, size_t n);
+void mi_hex_encode(char *d, const unsigned char *s, size_t n);
+size_t mi_mem_diff(const unsigned char *a, const unsigned char *b, size_t n);
+const unsigned char *mi_mem_find(const unsigned char *s, size_t n,
+                                 const unsigned char *p, size_t m);
+/* Command without the token and the console wrapper. */
+const char *mi_cmd_name(const char *cmd);
+/* Cache for target memory, valid while the inferior is stopped. */
+int mi_set_mem_cache(mi_h *h, int pages);
+void mi_mem_cache_invalidate(mi_h *h);
+void mi_get_mem_cache_stats(mi_h *h, unsigned long *hits,
+                            unsigned long *misses);
+void mi_mem_cache_cmd(mi_h *h, const char *cmd);
+long mi_mem_cache_read(mi_h *h, unsigned long addr, unsigned long size,
+                       unsigned char *dest, mi_mem_region **regions);
+/* Cache for disassembly, keyed by object, range and mode. */
+int mi_set_disasm_cache(mi_h *h, int entries, const char *file);
+int mi_disasm_cache_object(mi_h *h, const char *file);
+void mi_get_disasm_cache_stats(mi_h *h, unsigned long *hits,
+                               unsigned long *misses);
+void mi_disasm_cache_cmd(mi_h *h, const char *cmd);
+char *mi_disasm_cache_key(mi_h *h, const char *kind, const char *a,
+                          const char *b, int mode);
+mi_asm_block *mi_disasm_cache_get(mi_h *h, const char *key);
+int mi_disasm_cache_put(mi_h *h, const char *key, mi_asm_block *b);
 /* Functions to set/get the tunneled streams callbacks. */
 void mi_set_console_cb(mi_h *h, stream_cb cb, void *data);
 void mi_set_target_cb(mi_h *h, stream_cb cb, void *data);
@@ -439,6 +936,9 @@ stream_cb mi_get_log_cb(mi_h *h, void **data);
 /* The callback to deal with async events. */
 void mi_set_async_cb(mi_h *h, async_cb cb, void *data);
 async_cb mi_get_async_cb(mi_h *h, void **data);
+/* Report the results of ^done as events (mi_parse_gdb_output_ev). */
+void mi_set_event_cb(mi_h *h, event_cb cb, void *data);
+event_cb mi_get_event_cb(mi_h *h, void **data);
 /* Time out in gdb responses. */
 void mi_set_time_out_cb(mi_h *h, tm_cb cb, void *data);
 tm_cb mi_get_time_out_cb(mi_h *h, void **data);
@@ -451,14 +951,35 @@ stream_cb mi_get_to_gdb_cb(mi_h *h, void **data);
 stream_cb mi_get_from_gdb_cb(mi_h *h, void **data);
 /* Sends a message to gdb. */
 int mi_send(mi_h *h, const char *format, ...);
+/* Sends a message prefixed with a token. Returns the token or 0 on error.
+   Many of them can be sent before asking for the results. */
+int mi_send_tk(mi_h *h, const char *format, ...);
 /* Wait until gdb sends a response. */
 mi_output *mi_get_response_blk(mi_h *h);
+/* Wait until gdb answers the command sent with this token. */
+mi_output *mi_get_response_tk(mi_h *h, int token);
+/* Get the answer for this token if already available. Doesn't wait. */
+mi_output *mi_retire_response_tk(mi_h *h, int token);
+/* Sends a command, the callback is called when gdb answers. Doesn't wait. */
+int mi_submit(mi_h *h, const char *cmd, done_cb cb, void *data);
+/* Reads what gdb sent and calls the completions. Doesn't wait. */
+int mi_process_input(mi_h *h);
+/* Event loop for many sessions. */
+mi_reactor *mi_reactor_create(void);
+void mi_reactor_free(mi_reactor *r);
+int  mi_reactor_add(mi_reactor *r, mi_h *h, reactor_cb cb, void *data);
+int  mi_reactor_remove(mi_reactor *r, mi_h *h);
+int  mi_reactor_run_once(mi_reactor *r, int time_out);
 /* Check if gdb sent a complete response. Use with mi_retire_response. */
 int mi_get_response(mi_h *h);
 /* Get the last response. Use with mi_get_response. */
 mi_output *mi_retire_response(mi_h *h);
 /* Look for a result record in gdb output. */
 mi_output *mi_get_rrecord(mi_output *r);
+/* Elements of a tuple or list, O(1) when parsed using an arena. */
+mi_results *mi_get_var_r(mi_results *r, const char *var);
+mi_results *mi_get_nth_r(mi_results *r, int n);
+int mi_count_results(mi_results *r);
 /* Look if the output contains an async stop.
    If that's the case return the reason for the stop.
    If the output contains an error the description is returned in reason. */
@@ -473,6 +994,9 @@ int mi_res_simple_running(mi_h *h);
 int mi_res_simple_connected(mi_h *h);
 /* It additionally extracts an specified variable. */
 mi_results *mi_res_done_var(mi_h *h, const char *var);
+/* The same for commands sent with mi_send_tk. */
+int mi_res_simple_done_tk(mi_h *h, int token);
+mi_results *mi_res_done_var_tk(mi_h *h, int token, const char *var);
 /* Extract a frames list from the response. */
 mi_frames *mi_res_frames_array(mi_h *h, const char *var);
 mi_frames *mi_res_frames_list(mi_h *h);
@@ -506,6 +1030,7 @@ const char *mi_lang_enum_to_str(enum mi_gvar_lang lang);
 int mi_res_changelist(mi_h *h, mi_gvar_chg **changed);
 int mi_res_children(mi_h *h, mi_gvar *v);
 mi_bkpt *mi_res_bkpt(mi_h *h);
+mi_bkpt *mi_get_bkpt(mi_results *p);
 mi_wp *mi_res_wp(mi_h *h);
 char *mi_res_value(mi_h *h);
 mi_stop *mi_res_stop(mi_h *h);
@@ -513,7 +1038,14 @@ enum mi_stop_reason mi_reason_str_to_enum(const char *s);
 const char *mi_reason_enum_to_str(enum mi_stop_reason r);
 int mi_get_read_memory(mi_h *h, unsigned char *dest, unsigned ws, int *na,
                        unsigned long *addr);
+long mi_get_read_memory_bytes(mi_output *o, unsigned long addr,
+                              unsigned long size, unsigned char *dest,
+                              mi_mem_region **regions);
+int mi_add_mem_region(mi_mem_region **regions, unsigned long start,
+                      unsigned long end);
 mi_asm_insns *mi_get_asm_insns(mi_h *h);
+mi_asm_block *mi_get_asm_block(mi_h *h);
+mi_asm_insns *mi_asm_block_to_insns(mi_asm_block *b);
 /* Starting point of the program. */
 void mi_set_main_func(const char *name);
 const char *mi_get_main_func();
@@ -539,8 +1071,20 @@ mi_stop          *mi_alloc_stop(void);
 mi_asm_insns     *mi_alloc_asm_insns(void);
 mi_asm_insn      *mi_alloc_asm_insn(void);
 mi_chg_reg       *mi_alloc_chg_reg(void);
+mi_mem_region    *mi_alloc_mem_region(void);
+mi_mem_write     *mi_alloc_mem_write(void);
+mi_asm_block     *mi_alloc_asm_block(int count, int nlines, size_t text_size);
+mi_arena         *mi_arena_create(void);
+mi_inc           *mi_alloc_inc(void);
+void *mi_arena_alloc(mi_arena *a, size_t sz);
+void mi_arena_reset(mi_arena *a);
+mi_arena *mi_arena_of(void *p);
+mi_results *mi_copy_results(mi_results *r);
+void mi_free_arena(mi_arena *a);
 void mi_free_output(mi_output *r);
 void mi_free_output_but(mi_output *r, mi_output *no, mi_results *no_r);
+void mi_free_pending(mi_pending *p);
+void mi_free_inc(mi_inc *p);
 void mi_free_frames(mi_frames *f);
 void mi_free_aux_term(mi_aux_term *t);
 void mi_free_results(mi_results *r);
@@ -553,6 +1097,9 @@ void mi_free_asm_insns(mi_asm_insns *i);
 void mi_free_asm_insn(mi_asm_insn *i);
 void mi_free_charp_list(char **l);
 void mi_free_chg_reg(mi_chg_reg *r);
+void mi_free_mem_region(mi_mem_region *r);
+void mi_free_mem_write(mi_mem_write *w);
+void mi_free_asm_block(mi_asm_block *b);
 
 /* Porgram control: */
 /* Specify the executable and arguments for local debug. */
@@ -628,10 +1175,45 @@ int gmi_break_set_times(mi_h *h, int number, int count);
 int gmi_break_set_condition(mi_h *h, int number, const char *condition);
 /* Enable or disable a breakpoint. */
 int gmi_break_state(mi_h *h, int number, int enable);
+/* The same for many breakpoints, the commands are pipelined. */
+int gmi_break_insert_l(mi_h *h, int count, const char **where,
+                       const char **cond, int temporary, int hard_assist,
+                       mi_bkpt_res *res);
+int gmi_break_delete_l(mi_h *h, const int *numbers, int count);
+int gmi_break_state_l(mi_h *h, const int *numbers, int count, int enable);
 /* Set a watchpoint. It doesn't work for remote targets! */
 mi_wp *gmi_break_watch(mi_h *h, enum mi_wp_mode mode, const char *exp);
 
 mi_results *gmi_break_list(mi_h *h);
+/* Breakpoints of the session, kept updated by the library. */
+int  mi_set_bkpt_table(mi_h *h, int enable);
+int  mi_bkpt_table_add(mi_h *h, mi_bkpt *b);
+int  mi_bkpt_table_del(mi_h *h, int number);
+void mi_bkpt_table_notify(mi_h *h, mi_output *o);
+int  mi_bkpt_table_list(mi_h *h, mi_results *r);
+mi_bkpt *mi_get_bkpt_by_num(mi_h *h, int number);
+mi_bkpt *mi_get_bkpt_by_addr(mi_h *h, void *addr);
+mi_bkpt *mi_get_bkpt_by_line(mi_h *h, const char *file, int line);
+mi_bkpt *mi_get_stop_bkpt(mi_h *h, mi_stop *s);
+int  mi_get_bkpt_count(mi_h *h);
+/* dprintf probes, their output is collected in a ring buffer. */
+int  mi_set_dprintf(mi_h *h, int events);
+int  gmi_dprintf_insert(mi_h *h, const char *where, const char *cond,
+                        int nfields, const char **exps, const char **fmts);
+int  gmi_dprintf_delete(mi_h *h, int probe);
+int  mi_get_dprintf_bkpt(mi_h *h, int probe);
+int  mi_get_dprintf_event(mi_h *h, mi_dprintf_ev *ev);
+void mi_get_dprintf_stats(mi_h *h, unsigned long long *events,
+                          unsigned long *lost);
+char *mi_dprintf_stream(mi_h *h, char *text);
+int  mi_dprintf_notify(mi_output *o);
+/* Breakpoints that collect some data and continue, without a round trip
+   to the application. */
+int  mi_set_auto_continue(mi_h *h, int bkptno, const mi_collect *c);
+void mi_set_hit_cb(mi_h *h, hit_cb cb, void *data);
+unsigned long mi_get_auto_continue_hits(mi_h *h, int bkptno);
+int  mi_autocont_notify(mi_h *h, mi_output *o);
+void mi_autocont_flush(mi_h *h);
 
 /* Data Manipulation. */
 /* Evaluate an expression. Returns a parsed tree. */
@@ -642,10 +1224,57 @@ int gmi_dir(mi_h *h, const char *path);
 int gmi_read_memory(mi_h *h, const char *exp, unsigned size,
                     unsigned char *dest, int *na, int convAddr,
                     unsigned long *addr);
+/* Read a memory block of any size, holes are reported as regions. */
+long gmi_read_memory_bytes(mi_h *h, unsigned long addr, unsigned long size,
+                           unsigned char *dest, mi_mem_region **regions);
+/* The same, but never served from the memory cache. */
+long mi_read_memory_bytes(mi_h *h, unsigned long addr, unsigned long size,
+                          unsigned char *dest, mi_mem_region **regions);
+/* Write a memory block of any size, or a list of them. */
+long gmi_write_memory(mi_h *h, unsigned long addr, const unsigned char *buf,
+                      unsigned long len);
+long gmi_write_memory_l(mi_h *h, mi_mem_write *l);
+/* Search a byte pattern in the target memory. */
+long gmi_find_memory(mi_h *h, unsigned long start, unsigned long len,
+                     const unsigned char *pat, size_t plen,
+                     unsigned long *matches, long max);
+int  mi_data_read_memory_bytes_tk(mi_h *h, unsigned long addr,
+                                  unsigned long size);
+/* Dump memory ranges to a file, without keeping them in memory. */
+long gmi_dump_memory_regions(mi_h *h, mi_mem_region *ranges, int fd,
+                             int resume);
+long gmi_dump_memory_regions_f(mi_h *h, mi_mem_region *ranges,
+                               const char *file, int resume);
+/* Memory ranges compared at each stop. */
+int  mi_track_memory(mi_h *h, unsigned long start, unsigned long end);
+int  mi_untrack_memory(mi_h *h, unsigned long start);
+void mi_clear_tracked_memory(mi_h *h);
+int  gmi_update_tracked_memory(mi_h *h);
+mi_mem_region *mi_get_memory_changes(mi_h *h);
+/* Register cache, refreshed at each stop. */
+int  mi_set_reg_cache(mi_h *h, int enable, enum mi_gvar_fmt fmt);
+void mi_reg_cache_cmd(mi_h *h, const char *cmd);
+int  gmi_update_reg_cache(mi_h *h);
+int  mi_get_reg_count(mi_h *h);
+const char *mi_get_reg_name(mi_h *h, int reg);
+const char *mi_get_reg_value(mi_h *h, int reg);
+int  mi_get_reg_changed(mi_h *h, int reg);
+mi_chg_reg *mi_get_reg_cache_changed(mi_h *h);
+/* Register contents as binary. */
+int  gmi_load_reg_sizes(mi_h *h);
+int  mi_get_reg_size(mi_h *h, int reg);
+int  mi_decode_reg_raw(const char *val, unsigned char *d, int size);
+long gmi_data_list_register_raw(mi_h *h, const int *regs, int count,
+                                unsigned char *buf, size_t size);
 mi_asm_insns *gmi_data_disassemble_se(mi_h *h, const char *start,
                                       const char *end, int mode);
 mi_asm_insns *gmi_data_disassemble_fl(mi_h *h, const char *file, int line,
                                       int lines, int mode);
+/* Same but using arrays, better for big disassemblies. */
+mi_asm_block *gmi_data_disassemble_se_b(mi_h *h, const char *start,
+                                        const char *end, int mode);
+mi_asm_block *gmi_data_disassemble_fl_b(mi_h *h, const char *file, int line,
+                                        int lines, int mode);
 mi_chg_reg *gmi_data_list_register_names(mi_h *h, int *how_many);
 int gmi_data_list_register_names_l(mi_h *h, mi_chg_reg *l);
 mi_chg_reg *gmi_data_list_changed_registers(mi_h *h);
@@ -717,6 +1346,10 @@ int gmi_var_list_children(mi_h *h, mi_gvar *var);
 
 /* C++ interface */
 
+#if __cplusplus>=201103L
+ #include <future>
+#endif
+
 /*
  State                Can:
  disconnected         Connect
@@ -840,6 +1473,22 @@ public:
  }
  int AssigngVar(mi_gvar *var, const char *exp);
  int Send(const char *command);
+ /* Commands that don't wait, see mi_submit. */
+ int Submit(const char *command, done_cb cb, void *data=NULL)
+ {
+  if (state==disconnected)
+     return 0;
+  return mi_submit(h,command,cb,data);
+ }
+ #if __cplusplus>=201103L
+ std::future<mi_output *> SubmitFuture(const char *command);
+ #endif
+ int ProcessInput()
+ {
+  if (state==disconnected)
+     return -1;
+  return mi_process_input(h);
+ }
  int Version()
  {
   if (state==running || state==disconnected)
@@ -859,6 +1508,28 @@ public:
      return 0;
   return gmi_read_memory(h,exp,size,dest,&na,convAddr,addr);
  }
+ long ReadMemoryBytes(unsigned long addr, unsigned long size,
+                      unsigned char *dest, mi_mem_region **regions=NULL)
+ {
+  if (state!=stopped)
+     return -1;
+  return gmi_read_memory_bytes(h,addr,size,dest,regions);
+ }
+ long FindMemory(unsigned long start, unsigned long len,
+                 const unsigned char *pat, size_t plen,
+                 unsigned long *matches, long max)
+ {
+  if (state!=stopped)
+     return -1;
+  return gmi_find_memory(h,start,len,pat,plen,matches,max);
+ }
+ long WriteMemory(unsigned long addr, const unsigned char *buf,
+                  unsigned long len)
+ {
+  if (state!=stopped)
+     return -1;
+  return gmi_write_memory(h,addr,buf,len);
+ }
  char *Show(const char *var);
  int ThreadListIDs(int *&list)
  {
@@ -890,6 +1561,19 @@ public:
      return NULL;
   return gmi_data_disassemble_fl(h,file,line,lines,mode);
  }
+ mi_asm_block *DisassembleBlock(const char *start, const char *end, int mode)
+ {
+  if (state!=stopped)
+     return NULL;
+  return gmi_data_disassemble_se_b(h,start,end,mode);
+ }
+ mi_asm_block *DisassembleBlock(const char *file, int line, int lines,
+                                int mode)
+ {
+  if (state!=stopped)
+     return NULL;
+  return gmi_data_disassemble_fl_b(h,file,line,lines,mode);
+ }
  mi_chg_reg *GetRegisterNames(int *how_many)
  {
   if (state!=target_specified && state!=stopped)
@@ -918,6 +1602,8 @@ public:
  {
   if (state!=stopped)
      return NULL;
+  if (h->rcache)
+     return mi_get_reg_cache_changed(h);
   mi_chg_reg *chg=gmi_data_list_changed_registers(h);
   if (chg && !gmi_data_list_register_values(h,fm_natural,chg))
     {
@@ -956,6 +1642,80 @@ public:
    { mi_set_log_cb(h,cb,data); }
  void SetAsyncCB(async_cb cb, void *data=NULL)
    { mi_set_async_cb(h,cb,data); }
+ int SetMemCache(int pages)
+   { return mi_set_mem_cache(h,pages); }
+ int TrackMemory(unsigned long start, unsigned long end)
+   { return mi_track_memory(h,start,end); }
+ int UntrackMemory(unsigned long start)
+   { return mi_untrack_memory(h,start); }
+ mi_mem_region *GetMemoryChanges()
+   { return mi_get_memory_changes(h); }
+ int SetDisasmCache(int entries, const char *file=NULL)
+   { return mi_set_disasm_cache(h,entries,file); }
+ int SetDisasmCacheObject(const char *file)
+   { return mi_disasm_cache_object(h,file); }
+ int SetBkptTable(int enable)
+   { return mi_set_bkpt_table(h,enable); }
+ mi_bkpt *FindBreakpoint(int number)
+   { return mi_get_bkpt_by_num(h,number); }
+ mi_bkpt *FindBreakpoint(void *addr)
+   { return mi_get_bkpt_by_addr(h,addr); }
+ mi_bkpt *FindBreakpoint(const char *file, int line)
+   { return mi_get_bkpt_by_line(h,file,line); }
+ int SetDprintf(int events)
+   { return mi_set_dprintf(h,events); }
+ int Dprintf(const char *where, int nfields, const char **exps,
+             const char **fmts=NULL, const char *cond=NULL)
+ {
+  if (state!=target_specified && state!=stopped)
+     return 0;
+  return gmi_dprintf_insert(h,where,cond,nfields,exps,fmts);
+ }
+ int DprintfDelete(int probe)
+ {
+  if (state!=target_specified && state!=stopped)
+     return 0;
+  return gmi_dprintf_delete(h,probe);
+ }
+ int GetDprintfEvent(mi_dprintf_ev *ev)
+   { return mi_get_dprintf_event(h,ev); }
+ int SetAutoContinue(int bkptno, const mi_collect *c)
+   { return mi_set_auto_continue(h,bkptno,c); }
+ void SetHitCB(hit_cb cb, void *data=NULL)
+   { mi_set_hit_cb(h,cb,data); }
+ int Breakpoints(int count, const char **where, mi_bkpt_res *res,
+                 const char **cond=NULL, bool temporary=false,
+                 bool hard_assist=false)
+ {
+  if (state!=target_specified && state!=stopped)
+     return -1;
+  return gmi_break_insert_l(h,count,where,cond,temporary,hard_assist,res);
+ }
+ int BreakDelete(const int *numbers, int count)
+ {
+  if (state!=target_specified && state!=stopped)
+     return 0;
+  return gmi_break_delete_l(h,numbers,count);
+ }
+ int BreakState(const int *numbers, int count, bool enable)
+ {
+  if (state!=target_specified && state!=stopped)
+     return 0;
+  return gmi_break_state_l(h,numbers,count,enable);
+ }
+ int SetRegCache(int enable, enum mi_gvar_fmt fmt=fm_natural)
+   { return mi_set_reg_cache(h,enable,fmt); }
+ int GetRegisterSize(int reg)
+   { return gmi_load_reg_sizes(h)<0 ? 0 : mi_get_reg_size(h,reg); }
+ long GetRegistersRaw(const int *regs, int count, unsigned char *buf,
+                      size_t size)
+ {
+  if (state!=stopped)
+     return -1;
+  return gmi_data_list_register_raw(h,regs,count,buf,size);
+ }
+ void GetMemCacheStats(unsigned long *hits, unsigned long *misses)
+   { mi_get_mem_cache_stats(h,hits,misses); }
  void SetToGDBCB(stream_cb cb, void *data=NULL)
    { mi_set_to_gdb_cb(h,cb,data); }
  void SetFromGDBCB(stream_cb cb, void *data=NULL)
@@ -25,12 +25,219 @@ tree (could be a complex one) that we can easily interpret using C code.
 ***************************************************************************/
 
 #include <ctype.h>
+#include <stddef.h>
 #include <string.h>
 #include <assert.h>
 #include "mi_gdb.h"
 
-mi_results *mi_get_result(const char *str, const char **end);
-int mi_get_value(mi_results *r, const char *str, const char **end);
+/* State of the parser, passed to all the functions so we can parse in many
+   threads (or from a callback of the parser). */
+typedef struct
+{
+ /* Arena used by mi_parse_gdb_output_arena, NULL to use malloc. */
+ mi_arena *arena;
+ /* With an arena the nodes are first created here, then the elements of
+    each tuple and list are packed in a mi_rs_array. */
+ mi_arena *scratch;
+ /* The line is a copy we own: keys and strings are terminated/unescaped in
+    place and the nodes point inside it. */
+ char in_place;
+ /* Used by mi_parse_gdb_output_ev, the results are reported as events
+    instead of building a tree. */
+ event_cb ev;
+ void *ev_data;
+} mi_parser;
+
+mi_results *mi_get_result(mi_parser *ps, const char *str, const char **end);
+int mi_get_value(mi_parser *ps, mi_results *r, const char *str,
+                 const char **end);
+
+/* Tuples of this size or bigger get an index by atom. */
+#define MI_RS_INDEX_MIN 8
+
+/* Perfect hash for the 65 known result names (at_addr to at_wpt): FNV-1a
+   seeded with 10508, the upper 8 bits select the slot. The tables are
+   generated, adding names needs a new seed. */
+#define MI_ATOM_SEED  10508u
+#define MI_ATOM_PRIME 16777619u
+#define MI_ATOM_SLOT(h) ((h)>>24 & 0xFF)
+
+static const unsigned char atom_slots[256]=
+{
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 0, 0, 0, 0,
+  0, 0, 0,39, 0, 0, 0, 0,30, 0, 0, 0,16,29, 0,21,
+ 61, 0, 0, 0, 0, 0, 0, 0, 0,43, 0, 5, 0, 0, 0,22,
+  0, 0,34,13, 0, 0,19, 0, 0, 0, 0, 0, 0, 4, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0,11, 0, 8, 0, 0, 0,
+  0, 0,57, 0, 0, 0, 0,35, 0, 0, 0,15,36, 0, 0, 0,
+  0,10, 0, 7, 0, 0, 0, 0, 0, 0, 0,58, 0, 0, 0,38,
+  0, 0, 9,46,25, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0,32, 0, 0,50,33, 0, 0, 0, 0,31,
+  0, 0, 0, 0, 0,28, 0, 0, 0,55,49, 0, 0,41, 0, 0,
+  0, 0, 0, 0, 0,18, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0,12, 0, 0,56,63, 0, 0, 0, 0, 0,42,
+ 65,23,45, 0, 0, 0, 0, 0,47, 0, 0,17, 0,62, 0,51,
+  0, 0, 0, 0, 0, 0,14, 0,64, 0,20, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0,52,44,40, 0,26,54, 0,37,
+  0, 0, 0, 0,24,27,53, 0, 0,59, 1, 0,60,48, 6, 2
+};
+
+static const char *atom_names[]=
+{
+ NULL, "addr", "address", "args", "asm_insns", "attr", "begin", "bkpt",
+ "bkptno", "changed-registers", "changelist", "child", "children", "cond",
+ "contents", "data", "depth", "disp", "enabled", "end", "exit-code", "exp",
+ "file", "format", "frame", "from", "fullname", "func", "func-name",
+ "gdb-result-var", "hw-awpt", "hw-rwpt", "ignore", "in_scope", "inst", "lang",
+ "level", "line", "line_asm_insn", "locals", "memory", "msg", "name", "new",
+ "new_num_children", "new_type", "number", "number-of-threads", "numchild",
+ "offset", "old", "reason", "register-names", "register-values",
+ "return-value", "signal-meaning", "signal-name", "src_and_asm_line", "stack",
+ "thread-id", "thread-ids", "times", "type", "value", "wpnum", "wpt"
+};
+
+static inline
+unsigned mi_atom_hash(unsigned h, char c)
+{
+ return (h^(unsigned char)c)*MI_ATOM_PRIME;
+}
+
+static
+enum mi_atom mi_atom_lookup(unsigned h, const char *var, int len)
+{
+ int a=atom_slots[MI_ATOM_SLOT(h)];
+
+ if (a && strncmp(atom_names[a],var,len)==0 && !atom_names[a][len])
+    return (enum mi_atom)a;
+ return at_unknown;
+}
+
+enum mi_atom mi_atom_of(const char *var)
+{
+ unsigned h=MI_ATOM_SEED;
+ const char *s;
+
+ for (s=var; *s; s++)
+     h=mi_atom_hash(h,*s);
+ return mi_atom_lookup(h,var,s-var);
+}
+
+const char *mi_atom_to_str(enum mi_atom a)
+{
+ if (a<=at_unknown || a>=(int)(sizeof(atom_names)/sizeof(atom_names[0])))
+    return NULL;
+ return atom_names[a];
+}
+
+static
+char *mi_parse_malloc(mi_parser *ps, size_t sz)
+{
+ return ps->arena ? (char *)mi_arena_alloc(ps->arena,sz) : mi_malloc(sz);
+}
+
+static
+mi_results *mi_parse_alloc_results(mi_parser *ps)
+{
+ mi_results *r;
+
+ if (!ps->arena)
+    return mi_alloc_results();
+ if (!ps->scratch && !(ps->scratch=mi_arena_create()))
+    return NULL;
+ r=(mi_results *)mi_arena_alloc(ps->scratch,sizeof(mi_results));
+ if (r)
+   {
+    memset(r,0,sizeof(mi_results));
+    r->arena=1;
+   }
+ return r;
+}
+
+/* Moves the elements of a tuple or list from the scratch arena to one block
+   of the record arena. */
+static
+int mi_pack_children(mi_parser *ps, mi_results *r)
+{
+ mi_results *c, *d;
+ mi_rs_array *a;
+ int n, i;
+
+ if (!ps->arena || !r->v.rs)
+    return 1;
+ for (n=0, c=r->v.rs; c; c=c->next)
+     n++;
+ a=(mi_rs_array *)mi_arena_alloc(ps->arena,offsetof(mi_rs_array,items)+
+                                 n*sizeof(mi_results));
+ if (!a)
+    return 0;
+ a->count=n;
+ a->index=NULL;
+ for (c=r->v.rs, d=a->items; c; c=c->next, d++)
+    {
+     *d=*c;
+     d->array=1;
+     d->next=c->next ? d+1 : NULL;
+    }
+ a->items[0].array=2;
+ r->v.rs=a->items;
+ if (r->type==t_tuple && n>=MI_RS_INDEX_MIN && n<=255)
+   {
+    a->index=(unsigned char *)mi_arena_alloc(ps->arena,at_last);
+    if (a->index)
+      {/* Backwards, so we get the first one. */
+       memset(a->index,0,at_last);
+       for (i=n-1; i>=0; i--)
+           if (a->items[i].atom)
+              a->index[a->items[i].atom]=i+1;
+      }
+   }
+ return 1;
+}
+
+/* The results of the record aren't packed, they are just moved to the
+   record arena. */
+static
+mi_results *mi_pack_node(mi_parser *ps, mi_results *r)
+{
+ mi_results *n;
+
+ if (!ps->arena || !r)
+    return r;
+ n=(mi_results *)mi_arena_alloc(ps->arena,sizeof(mi_results));
+ if (n)
+    *n=*r;
+ return n;
+}
+
+static inline
+mi_rs_array *mi_rs_array_of(mi_results *r)
+{
+ return (mi_rs_array *)((char *)r-offsetof(mi_rs_array,items));
+}
+
+/* Takes the string from a node. Nodes from an arena can't give it away, so
+   we return a copy. */
+static
+char *mi_steal_cstr(mi_results *r)
+{
+ char *s=r->v.cstr;
+
+ if (r->arena)
+    return s ? strdup(s) : NULL;
+ r->v.cstr=NULL;
+ return s;
+}
+
+static
+mi_results *mi_steal_rs(mi_results *r)
+{
+ mi_results *rs=r->v.rs;
+
+ if (r->arena)
+    return mi_copy_results(rs);
+ r->v.rs=NULL;
+ return rs;
+}
 
 
 /* GDB BUG!!!! I got:
@@ -49,11 +256,99 @@ int EndOfStr(const char *s)
  return 0;
 }
 
-int mi_get_cstring_r(mi_results *r, const char *str, const char **end)
+/* Decodes the escape after a backslash, s points after it. gdb uses the C
+   escapes and \NNN (octal) for the rest of the non-printable chars. */
+static
+char mi_unescape_char(const char **s)
+{
+ const char *p=*s;
+ int v, i;
+
+ *s=p+1;
+ switch (*p)
+   {
+    case 'n':
+         return '\n';
+    case 't':
+         return '\t';
+    case 'r':
+         return '\r';
+    case 'b':
+         return '\b';
+    case 'f':
+         return '\f';
+    case 'v':
+         return '\v';
+    case 'a':
+         return '\a';
+    case 'e':
+         return '\033';
+    case '0': case '1': case '2': case '3':
+    case '4': case '5': case '6': case '7':
+         for (v=0, i=0; i<3 && *p>='0' && *p<='7'; i++, p++)
+             v=v*8+*p-'0';
+         *s=p;
+         return (char)v;
+   }
+ return *p;
+}
+
+/* Unescapes the c-string at s (after the opening quote) to d. An unescaped
+   string is never longer than the escaped one, so d can be s and we do it
+   in place and with only one pass. The plain parts are found by
+   mi_scan_cstr. Returns the length or -1 on error. */
+static
+int mi_unescape(char *d, const char *s, const char **end)
+{
+ char *start=d;
+ const char *n;
+
+ while (1)
+   {
+    n=mi_scan_cstr(s);
+    if (d!=s)
+       memmove(d,s,n-s);
+    d+=n-s;
+    s=n;
+    if (*s=='\\')
+      {
+       s++;
+       if (!*s)
+         {
+          mi_error=MI_PARSER;
+          return -1;
+         }
+       *d++=mi_unescape_char(&s);
+      }
+    else if (*s=='"' && !EndOfStr(s))
+       *d++=*s++;
+    else
+       break;
+   }
+ if (end)
+    *end=*s ? s+1 : s;
+ *d=0;
+ return d-start;
+}
+
+static
+int mi_unescape_in_place(char *s, const char **end)
+{
+ return mi_unescape(s,s,end);
+}
+
+static
+int mi_get_cstring_in_place(mi_results *r, char *s, const char **end)
+{
+ r->type=t_const;
+ r->v.cstr=s;
+ return mi_unescape_in_place(s,end)>=0;
+}
+
+int mi_get_cstring_r(mi_parser *ps, mi_results *r, const char *str,
+                     const char **end)
 {
  const char *s;
- char *d;
- int len;
 
  if (*str!='"')
    {
@@ -61,75 +356,78 @@ int mi_get_cstring_r(mi_results *r, const char *str, const char **end)
     return 0;
    }
  str++;
- /* Meassure. */
- for (s=str, len=0; *s && !EndOfStr(s); s++)
+ if (ps->in_place)
+    return mi_get_cstring_in_place(r,(char *)str,end);
+ /* Meassure, the escaped length is enough. */
+ for (s=mi_scan_cstr(str); *s; s=mi_scan_cstr(s))
     {
      if (*s=='\\')
        {
-        if (!*s)
+        if (!s[1])
           {
            mi_error=MI_PARSER;
            return 0;
           }
-        s++;
+        s+=2;
        }
-     len++;
+     else if (!EndOfStr(s))
+        s++;
+     else
+        break;
     }
  /* Copy. */
  r->type=t_const;
- d=r->v.cstr=mi_malloc(len+1);
+ r->v.cstr=mi_parse_malloc(ps,s-str+1);
  if (!r->v.cstr)
     return 0;
- for (s=str; *s && !EndOfStr(s); s++, d++)
-    {
-     if (*s=='\\')
-       {
-        s++;
-        switch (*s)
-          {
-           case 'n':
-                *d='\n';
-                break;
-           case 't':
-                *d='\t';
-                break;
-           default:
-                *d=*s;
-          }
-       }
-     else
-        *d=*s;
-    }
- *d=0;
- if (end)
-    *end=s+1;
-
- return 1;
+ return mi_unescape(r->v.cstr,str,end)>=0;
 }
 
 /* TODO: What's a valid variable name?
    I'll assume a-zA-Z0-9_- */
-inline
+static const char var_name_chars[128]=
+{
+ 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+ 0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,1,1,1,1,1,1,1,1,1,1,0,0,0,0,0,0,
+ 0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,0,0,0,0,1,
+ 0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,0,0,0,0,0
+};
+
+static inline
 int mi_is_var_name_char(char c)
 {
- return isalnum(c) || c=='-' || c=='_';
+ return (unsigned char)c<128 && var_name_chars[(unsigned char)c];
 }
 
-char *mi_get_var_name(const char *str, const char **end)
+static
+char *mi_get_var_name_atom(mi_parser *ps, const char *str, const char **end,
+                           enum mi_atom *atom)
 {
  const char *s;
  char *r;
  int l;
- /* Meassure. */
- for (s=str; *s && mi_is_var_name_char(*s); s++);
+ unsigned h=MI_ATOM_SEED;
+ /* Meassure and hash. */
+ for (s=str; *s && mi_is_var_name_char(*s); s++)
+     h=mi_atom_hash(h,*s);
+ *atom=mi_atom_lookup(h,str,s-str);
  if (*s!='=')
    {
     mi_error=MI_PARSER;
     return NULL;
    }
+ if (ps->in_place)
+   {/* Just terminate it. */
+    *(char *)s=0;
+    if (end)
+       *end=s+1;
+    return (char *)str;
+   }
  /* Allocate. */
  l=s-str;
- r=mi_malloc(l+1);
+ r=mi_parse_malloc(ps,l+1);
+ if (!r)
+    return NULL;
  /* Copy. */
  memcpy(r,str,l);
  r[l]=0;
@@ -138,15 +436,22 @@ char *mi_get_var_name(const char *str, const char **end)
  return r;
 }
 
+char *mi_get_var_name(mi_parser *ps, const char *str, const char **end)
+{
+ enum mi_atom atom;
+ return mi_get_var_name_atom(ps,str,end,&atom);
+}
 
-int mi_get_list_res(mi_results *r, const char *str, const char **end, char closeC)
+
+int mi_get_list_res(mi_parser *ps, mi_results *r, const char *str,
+                    const char **end, char closeC)
 {
  mi_results *last_r, *rs;
 
  last_r=NULL;
  do
    {
-    rs=mi_get_result(str,&str);
+    rs=mi_get_result(ps,str,&str);
     if (last_r)
        last_r->next=rs;
     else
@@ -167,16 +472,18 @@ int mi_get_list_res(mi_results *r, const char *str, const char **end, char close
  return 0;
 }
 
-#ifdef __APPLE__
-int mi_get_tuple_val(mi_results *r, const char *str, const char **end)
+/* Tuples of values aren't valid MI, but Apple's gdb uses them and FSF gdb
+   too for the script of a breakpoint (i.e. script={"printf ..."}). */
+int mi_get_tuple_val(mi_parser *ps, mi_results *r, const char *str,
+                     const char **end)
 {
  mi_results *last_r, *rs;
 
  last_r=NULL;
  do
    {
-    rs=mi_alloc_results();
-    if (!rs || !mi_get_value(rs,str,&str))
+    rs=mi_parse_alloc_results(ps);
+    if (!rs || !mi_get_value(ps,rs,str,&str))
       {
        mi_free_results(rs);
        return 0;
@@ -202,9 +509,9 @@ int mi_get_tuple_val(mi_results *r, const char *str, const char **end)
  mi_error=MI_PARSER;
  return 0;
 }
-#endif /* __APPLE__ */
 
-int mi_get_tuple(mi_results *r, const char *str, const char **end)
+int mi_get_tuple(mi_parser *ps, mi_results *r, const char *str,
+                 const char **end)
 {
  if (*str!='{')
    {
@@ -218,24 +525,21 @@ int mi_get_tuple(mi_results *r, const char *str, const char **end)
     *end=str+1;
     return 1;
    }
- #ifdef __APPLE__
  if (mi_is_var_name_char(*str))
-    return mi_get_list_res(r,str,end,'}');
- return mi_get_tuple_val(r,str,end);
- #else /* __APPLE__ */
- return mi_get_list_res(r,str,end,'}');
- #endif /* __APPLE__ */
+    return mi_get_list_res(ps,r,str,end,'}');
+ return mi_get_tuple_val(ps,r,str,end);
 }
 
-int mi_get_list_val(mi_results *r, const char *str, const char **end)
+int mi_get_list_val(mi_parser *ps, mi_results *r, const char *str,
+                    const char **end)
 {
  mi_results *last_r, *rs;
 
  last_r=NULL;
  do
    {
-    rs=mi_alloc_results();
-    if (!rs || !mi_get_value(rs,str,&str))
+    rs=mi_parse_alloc_results(ps);
+    if (!rs || !mi_get_value(ps,rs,str,&str))
       {
        mi_free_results(rs);
        return 0;
@@ -262,7 +566,8 @@ int mi_get_list_val(mi_results *r, const char *str, const char **end)
  return 0;
 }
 
-int mi_get_list(mi_results *r, const char *str, const char **end)
+int mi_get_list(mi_parser *ps, mi_results *r, const char *str,
+                const char **end)
 {
  if (*str!='[')
    {
@@ -278,43 +583,47 @@ int mi_get_list(mi_results *r, const char *str, const char **end)
    }
  /* Comment: I think they could choose () for values. Is confusing in this way. */
  if (mi_is_var_name_char(*str))
-    return mi_get_list_res(r,str,end,']');
- return mi_get_list_val(r,str,end);
+    return mi_get_list_res(ps,r,str,end,']');
+ return mi_get_list_val(ps,r,str,end);
 }
 
-int mi_get_value(mi_results *r, const char *str, const char **end)
+int mi_get_value(mi_parser *ps, mi_results *r, const char *str,
+                 const char **end)
 {
  switch (str[0])
    {
     case '"':
-         return mi_get_cstring_r(r,str,end);
+         return mi_get_cstring_r(ps,r,str,end);
     case '{':
-         return mi_get_tuple(r,str,end);
+         return mi_get_tuple(ps,r,str,end) && mi_pack_children(ps,r);
     case '[':
-         return mi_get_list(r,str,end);
+         return mi_get_list(ps,r,str,end) && mi_pack_children(ps,r);
    }
  mi_error=MI_PARSER;
  return 0;
 }
 
-mi_results *mi_get_result(const char *str, const char **end)
+mi_results *mi_get_result(mi_parser *ps, const char *str, const char **end)
 {
  char *var;
  mi_results *r;
+ enum mi_atom atom;
 
- var=mi_get_var_name(str,&str);
+ var=mi_get_var_name_atom(ps,str,&str,&atom);
  if (!var)
     return NULL;
 
- r=mi_alloc_results();
+ r=mi_parse_alloc_results(ps);
  if (!r)
    {
-    free(var);
+    if (!ps->arena)
+       free(var);
     return NULL;
    }
  r->var=var;
+ r->atom=atom;
 
- if (!mi_get_value(r,str,end))
+ if (!mi_get_value(ps,r,str,end))
    {
     mi_free_results(r);
     return NULL;
@@ -323,10 +632,125 @@ mi_results *mi_get_result(const char *str, const char **end)
  return r;
 }
 
-mi_output *mi_get_results_alone(mi_output *r,const char *str)
+/*****************************************************************************
+  Event parser: reports the results without creating a tree. Only the
+current nesting is kept, in the C stack.
+*****************************************************************************/
+
+static int mi_ev_value(mi_parser *ps, const char *str, const char **end,
+                       const char *var, enum mi_atom atom, int depth);
+
+static
+int mi_ev_result(mi_parser *ps, const char *str, const char **end, int depth)
+{
+ enum mi_atom atom;
+ char *var=mi_get_var_name_atom(ps,str,&str,&atom);
+
+ if (!var)
+    return 0;
+ return mi_ev_value(ps,str,end,var,atom,depth);
+}
+
+/* Elements of a tuple or list, until closeC. */
+static
+int mi_ev_elements(mi_parser *ps, const char *str, const char **end,
+                   char closeC, int depth)
+{
+ int is_res=mi_is_var_name_char(*str);
+
+ if (*str==closeC)
+   {
+    *end=str+1;
+    return 1;
+   }
+ do
+   {
+    if (!(is_res ? mi_ev_result(ps,str,&str,depth) :
+                   mi_ev_value(ps,str,&str,NULL,at_unknown,depth)))
+       return 0;
+    if (*str==closeC)
+      {
+       *end=str+1;
+       return 1;
+      }
+    if (*str!=',')
+       break;
+    str++;
+   }
+ while (1);
+ mi_error=MI_PARSER;
+ return 0;
+}
+
+static
+int mi_ev_value(mi_parser *ps, const char *str, const char **end,
+                const char *var, enum mi_atom atom, int depth)
+{
+ mi_event e;
+ char closeC;
+
+ e.var=var;
+ e.atom=atom;
+ e.val=NULL;
+ e.len=0;
+ e.depth=depth;
+ switch (*str)
+   {
+    case '"':
+         e.type=ev_value;
+         e.val=str+1;
+         e.len=mi_unescape_in_place((char *)str+1,end);
+         if (e.len<0)
+            return 0;
+         ps->ev(&e,ps->ev_data);
+         return 1;
+    case '{':
+         e.type=ev_tuple;
+         closeC='}';
+         break;
+    case '[':
+         e.type=ev_list;
+         closeC=']';
+         break;
+    default:
+         mi_error=MI_PARSER;
+         return 0;
+   }
+ ps->ev(&e,ps->ev_data);
+ if (!mi_ev_elements(ps,str+1,end,closeC,depth+1))
+    return 0;
+ e.type=ev_end;
+ ps->ev(&e,ps->ev_data);
+ return 1;
+}
+
+static
+int mi_ev_results(mi_parser *ps, const char *str)
+{
+ while (*str)
+   {
+    if (*str!=',')
+      {
+       mi_error=MI_PARSER;
+       return 0;
+      }
+    if (!mi_ev_result(ps,str+1,&str,0))
+       return 0;
+   }
+ return 1;
+}
+
+mi_output *mi_get_results_alone(mi_parser *ps, mi_output *r, const char *str)
 {
  mi_results *last_r, *rs;
 
+ if (ps->ev)
+   {
+    if (mi_ev_results(ps,str))
+       return r;
+    mi_free_output(r);
+    return NULL;
+   }
  /* * results */
  last_r=NULL;
  do
@@ -339,7 +763,7 @@ mi_output *mi_get_results_alone(mi_output *r,const char *str)
        break;
       }
     str++;
-    rs=mi_get_result(str,&str);
+    rs=mi_pack_node(ps,mi_get_result(ps,str,&str));
     if (!rs)
        break;
     if (!last_r)
@@ -353,7 +777,7 @@ mi_output *mi_get_results_alone(mi_output *r,const char *str)
  return NULL;
 }
 
-mi_output *mi_parse_result_record(mi_output *r,const char *str)
+mi_output *mi_parse_result_record(mi_parser *ps, mi_output *r, const char *str)
 {
  r->type=MI_T_RESULT_RECORD;
 
@@ -389,10 +813,10 @@ mi_output *mi_parse_result_record(mi_output *r,const char *str)
     return NULL;
    }
 
- return mi_get_results_alone(r,str);
+ return mi_get_results_alone(ps,r,str);
 }
 
-mi_output *mi_parse_asyn(mi_output *r,const char *str)
+mi_output *mi_parse_asyn(mi_parser *ps, mi_output *r, const char *str)
 {
  r->type=MI_T_OUT_OF_BAND;
  r->stype=MI_ST_ASYNC;
@@ -401,43 +825,67 @@ mi_output *mi_parse_asyn(mi_output *r,const char *str)
    {
     r->tclass=MI_CL_STOPPED;
     str+=7;
-    return mi_get_results_alone(r,str);
+    return mi_get_results_alone(ps,r,str);
    }
  if (strncmp(str,"download",8)==0)
    {
     r->tclass=MI_CL_DOWNLOAD;
     str+=8;
-    return mi_get_results_alone(r,str);
+    return mi_get_results_alone(ps,r,str);
+   }
+ if (strncmp(str,"running",7)==0)
+   {
+    r->tclass=MI_CL_RUNNING;
+    str+=7;
+    return mi_get_results_alone(ps,r,str);
    }
  mi_error=MI_UNKNOWN_ASYNC;
  mi_free_output(r);
  return NULL;
 }
 
-mi_output *mi_parse_exec_asyn(mi_output *r,const char *str)
+mi_output *mi_parse_exec_asyn(mi_parser *ps, mi_output *r, const char *str)
 {
  r->sstype=MI_SST_EXEC;
- return mi_parse_asyn(r,str);
+ return mi_parse_asyn(ps,r,str);
 }
 
-mi_output *mi_parse_status_asyn(mi_output *r,const char *str)
+mi_output *mi_parse_status_asyn(mi_parser *ps, mi_output *r, const char *str)
 {
  r->sstype=MI_SST_STATUS;
- return mi_parse_asyn(r,str);
+ return mi_parse_asyn(ps,r,str);
 }
 
-mi_output *mi_parse_notify_asyn(mi_output *r,const char *str)
+mi_output *mi_parse_notify_asyn(mi_parser *ps, mi_output *r, const char *str)
 {
  r->sstype=MI_SST_NOTIFY;
- return mi_parse_asyn(r,str);
+ /* Used to keep the breakpoint table (see mi_set_bkpt_table). */
+ if (strncmp(str,"breakpoint-",11)==0)
+   {
+    if (strncmp(str+11,"created",7)==0)
+       r->tclass=MI_CL_BKPT_CREATED;
+    else if (strncmp(str+11,"modified",8)==0)
+       r->tclass=MI_CL_BKPT_MODIFIED;
+    else if (strncmp(str+11,"deleted",7)==0)
+       r->tclass=MI_CL_BKPT_DELETED;
+    if (r->tclass)
+      {
+       r->type=MI_T_OUT_OF_BAND;
+       r->stype=MI_ST_ASYNC;
+       str=strchr(str,',');
+       return mi_get_results_alone(ps,r,str ? str : "");
+      }
+   }
+ return mi_parse_asyn(ps,r,str);
 }
 
-mi_output *mi_console(mi_output *r,const char *str)
+mi_output *mi_console(mi_parser *ps, mi_output *r, const char *str)
 {
  r->type=MI_T_OUT_OF_BAND;
  r->stype=MI_ST_STREAM;
- r->c=mi_alloc_results();
- if (!r->c || !mi_get_cstring_r(r->c,str,NULL))
+ /* The scratch nodes don't survive the parse. */
+ r->c=mi_pack_node(ps,mi_parse_alloc_results(ps));
+ if (!r->c || !mi_get_cstring_r(ps,r->c,str,NULL))
    {
     mi_free_output(r);
     return NULL;
@@ -445,56 +893,540 @@ mi_output *mi_console(mi_output *r,const char *str)
  return r;
 }
 
-mi_output *mi_console_stream(mi_output *r,const char *str)
+mi_output *mi_console_stream(mi_parser *ps, mi_output *r, const char *str)
 {
  r->sstype=MI_SST_CONSOLE;
- return mi_console(r,str);
+ return mi_console(ps,r,str);
 }
 
-mi_output *mi_target_stream(mi_output *r,const char *str)
+mi_output *mi_target_stream(mi_parser *ps, mi_output *r, const char *str)
 {
  r->sstype=MI_SST_TARGET;
- return mi_console(r,str);
+ return mi_console(ps,r,str);
 }
 
-mi_output *mi_log_stream(mi_output *r,const char *str)
+mi_output *mi_log_stream(mi_parser *ps, mi_output *r, const char *str)
 {
  r->sstype=MI_SST_LOG;
- return mi_console(r,str);
+ return mi_console(ps,r,str);
 }
 
-mi_output *mi_parse_gdb_output(const char *str)
+static
+mi_output *mi_parse_output(mi_parser *ps, const char *str)
 {
- char type=str[0];
+ char type;
+ int token=0;
+
+ mi_output *r;
 
- mi_output *r=mi_alloc_output();
+ if (ps->arena)
+   {
+    r=(mi_output *)mi_arena_alloc(ps->arena,sizeof(mi_output));
+    if (r)
+      {
+       memset(r,0,sizeof(mi_output));
+       r->arena=ps->arena;
+      }
+   }
+ else
+    r=mi_alloc_output();
  if (!r)
    {
     mi_error=MI_OUT_OF_MEMORY;
     return NULL;
    }
+ /* Optional token, used to match the answers (mi_send_tk). */
+ for (; isdigit((unsigned char)*str); str++)
+     token=token*10+*str-'0';
+ r->token=token;
+ type=str[0];
  str++;
  switch (type)
    {
     case '^':
-         return mi_parse_result_record(r,str);
+         return mi_parse_result_record(ps,r,str);
     case '*':
-         return mi_parse_exec_asyn(r,str);
+         return mi_parse_exec_asyn(ps,r,str);
     case '+':
-         return mi_parse_status_asyn(r,str);
+         return mi_parse_status_asyn(ps,r,str);
     case '=':
-         return mi_parse_notify_asyn(r,str);
+         return mi_parse_notify_asyn(ps,r,str);
     case '~':
-         return mi_console_stream(r,str);
+         return mi_console_stream(ps,r,str);
     case '@':
-         return mi_target_stream(r,str);
+         return mi_target_stream(ps,r,str);
     case '&':
-         return mi_log_stream(r,str);
+         return mi_log_stream(ps,r,str);
    }   
+ mi_free_output(r);
  mi_error=MI_PARSER;
  return NULL;
 }
 
+mi_output *mi_parse_gdb_output(const char *str)
+{
+ mi_parser ps;
+
+ memset(&ps,0,sizeof(ps));
+ return mi_parse_output(&ps,str);
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Same as mi_parse_gdb_output, but all the nodes are allocated from one
+arena. The line is copied to the arena and parsed in place, the keys and
+strings point inside this copy, so they aren't allocated one by one. The
+whole record is released at once by mi_free_output. Subtrees kept with
+mi_free_output_but pin the arena until they are released with
+mi_free_results. The decoders (mi_parse_frame, etc.) make copies of the
+strings they keep.
+  
+  Return: The parsed record or NULL on error.
+  
+***************************************************************************/
+
+mi_output *mi_parse_gdb_output_arena(const char *str)
+{
+ mi_output *r=NULL;
+ mi_arena *a=mi_arena_create();
+ size_t len=strlen(str)+1;
+ char *copy;
+ mi_parser ps;
+
+ if (!a)
+    return NULL;
+ memset(&ps,0,sizeof(ps));
+ copy=(char *)mi_arena_alloc(a,len);
+ if (copy)
+   {
+    memcpy(copy,str,len);
+    /* Nobody owns the arena while parsing, so the error paths don't release
+       it. */
+    ps.arena=a;
+    ps.in_place=1;
+    r=mi_parse_output(&ps,copy);
+   }
+ /* The scratch nodes were copied to the record arena. */
+ mi_free_arena(ps.scratch);
+ if (r)
+    a->owner=r;
+ else
+    mi_free_arena(a);
+ return r;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Parses a line from gdb like mi_parse_gdb_output, but the results of a
+^done record are reported to @var{cb} as events (begin of tuple, begin of
+list, value and end) instead of building a tree. The record is returned
+without content. Other records are parsed as usual. The strings are
+unescaped in place, so @var{str} is modified and the events point inside
+it. Only the current nesting is stored, so it can deal with huge results.
+  
+  Return: The parsed record or NULL on error.
+  
+***************************************************************************/
+
+mi_output *mi_parse_gdb_output_ev(char *str, event_cb cb, void *data)
+{
+ const char *s;
+ mi_parser ps;
+
+ for (s=str; isdigit((unsigned char)*s); s++);
+ if (*s!='^' || strncmp(s+1,"done",4))
+    return mi_parse_gdb_output(str);
+ memset(&ps,0,sizeof(ps));
+ ps.ev=cb;
+ ps.ev_data=data;
+ ps.in_place=1;
+ return mi_parse_output(&ps,str);
+}
+
+/*****************************************************************************
+  Incremental parser: a state machine that consumes the bytes as they arrive
+from gdb. The nesting is kept in the mi_inc structure, so we can stop at any
+point and resume with the next read.
+*****************************************************************************/
+
+enum
+{
+ is_token=0, is_header, is_stream, is_key, is_value, is_elem, is_str, is_esc,
+ is_quote, is_after, is_skip, is_oct
+};
+
+static
+int mi_inc_addn(mi_inc *p, const char *s, int n)
+{
+ if (p->len+n>=p->size)
+   {
+    int nsize=p->size ? p->size*2 : 256;
+    char *nbuf;
+    while (nsize<=p->len+n)
+       nsize*=2;
+    nbuf=(char *)realloc(p->buf,nsize);
+    if (!nbuf)
+      {
+       mi_error=MI_OUT_OF_MEMORY;
+       return 0;
+      }
+    p->buf=nbuf;
+    p->size=nsize;
+   }
+ memcpy(p->buf+p->len,s,n);
+ p->len+=n;
+ return 1;
+}
+
+static inline
+int mi_inc_add(mi_inc *p, char c)
+{
+ return mi_inc_addn(p,&c,1);
+}
+
+static
+char *mi_inc_str(mi_inc *p)
+{
+ char *s=mi_malloc(p->len+1);
+
+ if (s)
+   {
+    memcpy(s,p->buf,p->len);
+    s[p->len]=0;
+   }
+ p->len=0;
+ return s;
+}
+
+/* Creates a node in the current tuple/list. */
+static
+mi_results *mi_inc_node(mi_inc *p)
+{
+ mi_inc_level *l=p->levels+p->depth;
+ mi_results *r=mi_alloc_results();
+
+ if (r)
+   {
+    *l->tail=r;
+    l->tail=&r->next;
+   }
+ return r;
+}
+
+static
+int mi_inc_push(mi_inc *p, mi_results *r, char close)
+{
+ if (p->depth+1>=p->max_depth)
+   {
+    int n=p->max_depth ? p->max_depth*2 : 16;
+    mi_inc_level *nl=(mi_inc_level *)realloc(p->levels,n*sizeof(mi_inc_level));
+    if (!nl)
+      {
+       mi_error=MI_OUT_OF_MEMORY;
+       return 0;
+      }
+    p->levels=nl;
+    p->max_depth=n;
+   }
+ p->depth++;
+ p->levels[p->depth].tail=&r->v.rs;
+ p->levels[p->depth].close=close;
+ return 1;
+}
+
+/* The header (token, type and class) is short, we collect it and let the
+   regular parser solve it. */
+static
+int mi_inc_header(mi_inc *p)
+{
+ /* Nothing collected yet, i.e. a ',' at the start of the line. */
+ if (!p->buf && !mi_inc_addn(p,"",0))
+    return 0;
+ p->buf[p->len]=0;
+ p->len=0;
+ if (strncmp(p->buf,"(gdb)",5)==0)
+   {
+    p->prompt=1;
+    return 1;
+   }
+ p->o=mi_parse_gdb_output(p->buf);
+ if (!p->o)
+    return 0;
+ p->o->token=p->token;
+ if (!p->max_depth)
+   {
+    p->levels=(mi_inc_level *)mi_malloc(16*sizeof(mi_inc_level));
+    if (!p->levels)
+      {
+       mi_free_output(p->o);
+       p->o=NULL;
+       return 0;
+      }
+    p->max_depth=16;
+   }
+ p->depth=0;
+ p->levels[0].tail=&p->o->c;
+ return 1;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Feeds @var{len} bytes from gdb to the incremental parser. The parser stops
+at the end of a line, @var{used} returns how many bytes were consumed. The
+parsed record is left in @var{p}->o (NULL if the line wasn't valid) and
+@var{p}->prompt indicates we got a (gdb) prompt. The caller must take the
+record before feeding more bytes.
+  
+  Return: 1 if a line was completed, 0 if we need more bytes.
+  
+***************************************************************************/
+
+int mi_inc_feed(mi_inc *p, const char *s, int len, int *used)
+{
+ const char *start=s, *e=s+len, *n;
+ char c;
+ mi_results *r;
+
+ for (; s<e; s++)
+    {
+     c=*s;
+     if (c=='\r')
+        continue;
+     p->in_line=1;
+again:
+     switch (p->state)
+       {
+        case is_token:
+             if (isdigit((unsigned char)c))
+               {
+                p->token=p->token*10+c-'0';
+                break;
+               }
+             p->state=is_header;
+             p->o=NULL;
+             p->prompt=0;
+             p->len=0;
+             if (c=='~' || c=='@' || c=='&')
+               {/* Streams are just a c-string. */
+                p->o=mi_alloc_output();
+                if (!p->o)
+                   goto error;
+                p->o->type=MI_T_OUT_OF_BAND;
+                p->o->stype=MI_ST_STREAM;
+                p->o->sstype=c=='~' ? MI_SST_CONSOLE :
+                             c=='@' ? MI_SST_TARGET : MI_SST_LOG;
+                p->state=is_stream;
+                break;
+               }
+             goto again;
+        case is_header:
+             if (c=='\n' && !p->len)
+                goto done;
+             if (c==',' || c=='\n')
+               {
+                if (!mi_inc_header(p))
+                  {/* mi_error already set. */
+                   p->state=is_skip;
+                   goto again;
+                  }
+                if (p->prompt)
+                  {
+                   p->state=is_skip;
+                   goto again;
+                  }
+                p->hash=MI_ATOM_SEED;
+                p->state=is_key;
+                if (c=='\n')
+                   goto done;
+                break;
+               }
+             if (!mi_inc_add(p,c))
+                goto error;
+             break;
+        case is_stream:
+             if (c!='"')
+                goto error;
+             p->o->c=p->cur=mi_alloc_results();
+             if (!p->cur)
+                goto error;
+             p->cur->type=t_const;
+             p->state=is_str;
+             break;
+        case is_key:
+             if (mi_is_var_name_char(c))
+               {
+                if (!mi_inc_add(p,c))
+                   goto error;
+                p->hash=mi_atom_hash(p->hash,c);
+                break;
+               }
+             if (c!='=')
+                goto error;
+             r=p->cur=mi_inc_node(p);
+             if (!r)
+                goto error;
+             r->atom=mi_atom_lookup(p->hash,p->buf,p->len);
+             r->var=mi_inc_str(p);
+             if (!r->var)
+                goto error;
+             p->state=is_value;
+             break;
+        case is_value:
+             r=p->cur;
+             switch (c)
+               {
+                case '"':
+                     r->type=t_const;
+                     p->state=is_str;
+                     break;
+                case '{':
+                     r->type=t_tuple;
+                     if (!mi_inc_push(p,r,'}'))
+                        goto error;
+                     p->state=is_elem;
+                     break;
+                case '[':
+                     r->type=t_list;
+                     if (!mi_inc_push(p,r,']'))
+                        goto error;
+                     p->state=is_elem;
+                     break;
+                default:
+                     goto error;
+               }
+             break;
+        case is_elem:
+             if (c==p->levels[p->depth].close)
+               {
+                p->depth--;
+                p->state=is_after;
+               }
+             else if (mi_is_var_name_char(c))
+               {
+                p->hash=MI_ATOM_SEED;
+                p->state=is_key;
+                goto again;
+               }
+             else
+               {/* Just a value. */
+                p->cur=mi_inc_node(p);
+                if (!p->cur)
+                   goto error;
+                p->state=is_value;
+                goto again;
+               }
+             break;
+        case is_str:
+             if (c=='\\')
+                p->state=is_esc;
+             else if (c=='"')
+                p->state=is_quote;
+             else if (c=='\n')
+               {/* Unterminated, take it as the end. */
+                p->state=is_quote;
+                goto again;
+               }
+             else
+               {/* Take the plain part in one go. */
+                n=mi_scan_line(s,e);
+                if (!mi_inc_addn(p,s,n-s))
+                   goto error;
+                s=n-1;
+               }
+             break;
+        case is_esc:
+             if (c=='\n')
+                goto error;
+             if (c>='0' && c<='7')
+               {
+                p->esc=c-'0';
+                p->esc_len=1;
+                p->state=is_oct;
+                break;
+               }
+             n=s;
+             c=mi_unescape_char(&n);
+             if (!mi_inc_add(p,c))
+                goto error;
+             p->state=is_str;
+             break;
+        case is_oct:
+             if (c>='0' && c<='7' && p->esc_len<3)
+               {
+                p->esc=p->esc*8+c-'0';
+                p->esc_len++;
+                break;
+               }
+             if (!mi_inc_add(p,(char)p->esc))
+                goto error;
+             p->state=is_str;
+             goto again;
+        case is_quote:
+             /* Same heuristic used by EndOfStr to survive gdb bugs. */
+             if (c==',' || c==']' || c=='}' || c=='\n')
+               {
+                p->cur->v.cstr=mi_inc_str(p);
+                if (!p->cur->v.cstr)
+                   goto error;
+                p->state=is_after;
+                goto again;
+               }
+             if (!mi_inc_add(p,'"'))
+                goto error;
+             p->state=is_str;
+             goto again;
+        case is_after:
+             if (c=='\n')
+               {
+                if (p->depth)
+                   goto error;
+                goto done;
+               }
+             if (c==',')
+               {
+                if (p->depth)
+                   p->state=is_elem;
+                else
+                  {
+                   p->hash=MI_ATOM_SEED;
+                   p->state=is_key;
+                  }
+               }
+             else if (p->depth && c==p->levels[p->depth].close)
+                p->depth--;
+             else
+                goto error;
+             break;
+        case is_skip:
+             if (c=='\n')
+                goto done;
+             break;
+       }
+     continue;
+error:
+     mi_error=MI_PARSER;
+     mi_free_output(p->o);
+     p->o=NULL;
+     p->state=is_skip;
+     if (c=='\n')
+        goto done;
+    }
+ *used=len;
+ return 0;
+
+done:
+ *used=s+1-start;
+ p->state=is_token;
+ p->token=0;
+ p->in_line=0;
+ p->len=0;
+ p->depth=0;
+ return 1;
+}
+
 mi_output *mi_get_rrecord(mi_output *r)
 {
  if (!r)
@@ -508,17 +1440,88 @@ mi_output *mi_get_rrecord(mi_output *r)
  return r;
 }
 
+/**[txh]********************************************************************
+
+  Description:
+  Looks for the result named @var{var} in the elements of a tuple or list,
+@var{r} is the first one. For big tuples parsed using an arena it uses the
+index of the mi_rs_array.
+
+  Return: The result or NULL if not found.
+
+***************************************************************************/
+
 mi_results *mi_get_var_r(mi_results *r, const char *var)
 {
+ enum mi_atom atom=mi_atom_of(var);
+ mi_rs_array *a;
+ int i;
+
+ if (atom && r && r->array==2)
+   {
+    a=mi_rs_array_of(r);
+    if (a->index)
+      {
+       i=a->index[atom];
+       return i ? a->items+i-1 : NULL;
+      }
+   }
  while (r)
    {
-    if (strcmp(r->var,var)==0)
+    if (atom ? r->atom==atom : r->var && strcmp(r->var,var)==0)
        return r;
     r=r->next;
    }
  return NULL;
 }
 
+/**[txh]********************************************************************
+
+  Description:
+  Gets the element number @var{n} of a tuple or list, @var{r} is the first
+element. It's O(1) for records parsed using an arena.
+
+  Return: The element or NULL if not that many.
+
+***************************************************************************/
+
+mi_results *mi_get_nth_r(mi_results *r, int n)
+{
+ mi_rs_array *a;
+
+ if (n<0)
+    return NULL;
+ if (r && r->array==2)
+   {
+    a=mi_rs_array_of(r);
+    return n<a->count ? a->items+n : NULL;
+   }
+ for (; r && n; n--)
+     r=r->next;
+ return r;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Counts the elements of a tuple or list, @var{r} is the first one. It's
+O(1) for records parsed using an arena.
+
+  Return: The number of elements.
+
+***************************************************************************/
+
+int mi_count_results(mi_results *r)
+{
+ int n;
+
+ if (r && r->array==2)
+    return mi_rs_array_of(r)->count;
+ for (n=0; r; r=r->next)
+     n++;
+ return n;
+}
+
 mi_results *mi_get_var(mi_output *res, const char *var)
 {
  if (!res)
@@ -584,13 +1587,11 @@ mi_frames *mi_get_async_frame(mi_output *r)
  return NULL;
 }
 
-int mi_res_simple(mi_h *h, int tclass, int accert_ret)
+static
+int mi_out_simple(mi_output *r, int tclass)
 {
- mi_output *r, *res;
- int ret=0;
-
- r=mi_get_response_blk(h);
- res=mi_get_rrecord(r);
+ mi_output *res=mi_get_rrecord(r);
+ int ret=0;
 
  if (res)
     ret=res->tclass==tclass;
@@ -599,6 +1600,11 @@ int mi_res_simple(mi_h *h, int tclass, int accert_ret)
  return ret;
 }
 
+int mi_res_simple(mi_h *h, int tclass, int accert_ret)
+{
+ return mi_out_simple(mi_get_response_blk(h),tclass);
+}
+
 
 int mi_res_simple_done(mi_h *h)
 {
@@ -620,12 +1626,17 @@ int mi_res_simple_connected(mi_h *h)
  return mi_res_simple(h,MI_CL_CONNECTED,0);
 }
 
-mi_results *mi_res_var(mi_h *h, const char *var, int tclass)
+int mi_res_simple_done_tk(mi_h *h, int token)
 {
- mi_output *r, *res;
+ return mi_out_simple(mi_get_response_tk(h,token),MI_CL_DONE);
+}
+
+static
+mi_results *mi_out_var(mi_output *r, const char *var, int tclass)
+{
+ mi_output *res;
  mi_results *the_var=NULL;
 
- r=mi_get_response_blk(h);
  /* All the code that follows is "NULL" tolerant. */
  /* Look for the result-record. */
  res=mi_get_rrecord(r);
@@ -637,11 +1648,21 @@ mi_results *mi_res_var(mi_h *h, const char *var, int tclass)
  return the_var;
 }
 
+mi_results *mi_res_var(mi_h *h, const char *var, int tclass)
+{
+ return mi_out_var(mi_get_response_blk(h),var,tclass);
+}
+
 mi_results *mi_res_done_var(mi_h *h, const char *var)
 {
  return mi_res_var(h,var,MI_CL_DONE);
 }
 
+mi_results *mi_res_done_var_tk(mi_h *h, int token, const char *var)
+{
+ return mi_out_var(mi_get_response_tk(h,token),var,MI_CL_DONE);
+}
+
 mi_frames *mi_parse_frame(mi_results *c)
 {
  mi_frames *res=mi_alloc_frames();
@@ -653,33 +1674,30 @@ mi_frames *mi_parse_frame(mi_results *c)
       {
        if (c->type==t_const)
          {
-          if (strcmp(c->var,"level")==0)
-             res->level=atoi(c->v.cstr);
-          else if (strcmp(c->var,"addr")==0)
-             res->addr=(void *)strtoul(c->v.cstr,&end,0);
-          else if (strcmp(c->var,"func")==0)
-            {
-             res->func=c->v.cstr;
-             c->v.cstr=NULL;
-            }
-          else if (strcmp(c->var,"file")==0)
-            {
-             res->file=c->v.cstr;
-             c->v.cstr=NULL;
-            }
-          else if (strcmp(c->var,"from")==0)
+          switch (c->atom)
             {
-             res->from=c->v.cstr;
-             c->v.cstr=NULL;
+             case at_level:
+                  res->level=atoi(c->v.cstr);
+                  break;
+             case at_addr:
+                  res->addr=(void *)strtoul(c->v.cstr,&end,0);
+                  break;
+             case at_func:
+                  res->func=mi_steal_cstr(c);
+                  break;
+             case at_file:
+                  res->file=mi_steal_cstr(c);
+                  break;
+             case at_from:
+                  res->from=mi_steal_cstr(c);
+                  break;
+             case at_line:
+                  res->line=atoi(c->v.cstr);
+                  break;
             }
-          else if (strcmp(c->var,"line")==0)
-             res->line=atoi(c->v.cstr);
-         }
-       else if (c->type==t_list && strcmp(c->var,"args")==0)
-         {
-          res->args=c->v.rs;
-          c->v.rs=NULL;
          }
+       else if (c->type==t_list && c->atom==at_args)
+          res->args=mi_steal_rs(c);
        c=c->next;
       }
    }
@@ -942,45 +1960,39 @@ mi_gvar *mi_get_gvar(mi_output *o, mi_gvar *cur, const char *expression)
    {
     if (r->type==t_const)
       {
-       if (strcmp(r->var,"name")==0)
-         {
-          free(res->name);
-          res->name=r->v.cstr;
-          r->v.cstr=NULL;
-         }
-       else if (strcmp(r->var,"numchild")==0)
-         {
-          res->numchild=atoi(r->v.cstr);
-         }
-       else if (strcmp(r->var,"type")==0)
-         {
-          free(res->type);
-          res->type=r->v.cstr;
-          r->v.cstr=NULL;
-          l=strlen(res->type);
-          if (l && res->type[l-1]=='*')
-             res->ispointer=1;
-         }
-       else if (strcmp(r->var,"lang")==0)
-         {
-          res->lang=mi_lang_str_to_enum(r->v.cstr);
-         }
-       else if (strcmp(r->var,"exp")==0)
-         {
-          free(res->exp);
-          res->exp=r->v.cstr;
-          r->v.cstr=NULL;
-         }
-       else if (strcmp(r->var,"format")==0)
+       switch (r->atom)
          {
-          res->format=mi_format_str_to_enum(r->v.cstr);
-         }
-       else if (strcmp(r->var,"attr")==0)
-         { /* Note: gdb 6.1.1 have only this: */
-          if (strcmp(r->v.cstr,"editable")==0)
-             res->attr=MI_ATTR_EDITABLE;
-          else /* noneditable */
-             res->attr=MI_ATTR_NONEDITABLE;
+          case at_name:
+               free(res->name);
+               res->name=mi_steal_cstr(r);
+               break;
+          case at_numchild:
+               res->numchild=atoi(r->v.cstr);
+               break;
+          case at_type:
+               free(res->type);
+               res->type=mi_steal_cstr(r);
+               l=strlen(res->type);
+               if (l && res->type[l-1]=='*')
+                  res->ispointer=1;
+               break;
+          case at_lang:
+               res->lang=mi_lang_str_to_enum(r->v.cstr);
+               break;
+          case at_exp:
+               free(res->exp);
+               res->exp=mi_steal_cstr(r);
+               break;
+          case at_format:
+               res->format=mi_format_str_to_enum(r->v.cstr);
+               break;
+          case at_attr:
+               /* Note: gdb 6.1.1 have only this: */
+               if (strcmp(r->v.cstr,"editable")==0)
+                  res->attr=MI_ATTR_EDITABLE;
+               else /* noneditable */
+                  res->attr=MI_ATTR_NONEDITABLE;
+               break;
          }
       }
     r=r->next;
@@ -1015,19 +2027,13 @@ mi_gvar_chg *mi_get_gvar_chg(mi_results *r)
        if (r->type==t_const)
          {
           if (strcmp(r->var,"name")==0)
-            {
-             n->name=r->v.cstr;
-             r->v.cstr=NULL;
-            }
+             n->name=mi_steal_cstr(r);
           else if (strcmp(r->var,"in_scope")==0)
             {
              n->in_scope=strcmp(r->v.cstr,"true")==0;
             }
           else if (strcmp(r->var,"new_type")==0)
-            {
-             n->new_type=r->v.cstr;
-             r->v.cstr=NULL;
-            }
+             n->new_type=mi_steal_cstr(r);
           else if (strcmp(r->var,"new_num_children")==0)
             {
              n->new_num_children=atoi(r->v.cstr);
@@ -1097,18 +2103,14 @@ int mi_res_changelist(mi_h *h, mi_gvar_chg **changed)
                 mi_free_gvar_chg(*changed);
                 return 0;
                }
-             n->name=r->v.cstr;
-             r->v.cstr=NULL;
+             n->name=mi_steal_cstr(r);
             }
           else if (strcmp(r->var,"in_scope")==0)
             {
              n->in_scope=strcmp(r->v.cstr,"true")==0;
             }
           else if (strcmp(r->var,"new_type")==0)
-            {
-             n->new_type=r->v.cstr;
-             r->v.cstr=NULL;
-            }
+             n->new_type=mi_steal_cstr(r);
           else if (strcmp(r->var,"new_num_children")==0)
             {
              n->new_num_children=atoi(r->v.cstr);
@@ -1139,7 +2141,7 @@ int mi_get_children(mi_results *ch, mi_gvar *v)
 
  while (ch)
    {
-    if (strcmp(ch->var,"child")==0 && ch->type==t_tuple && i<count)
+    if (ch->atom==at_child && ch->type==t_tuple && i<count)
       {
        mi_results *r=ch->v.rs;
        aux=mi_alloc_gvar();
@@ -1157,32 +2159,26 @@ int mi_get_children(mi_results *ch, mi_gvar *v)
          {
           if (r->type==t_const)
             {
-             if (strcmp(r->var,"name")==0)
-               {
-                cur->name=r->v.cstr;
-                r->v.cstr=NULL;
-               }
-             else if (strcmp(r->var,"exp")==0)
-               {
-                cur->exp=r->v.cstr;
-                r->v.cstr=NULL;
-               }
-             else if (strcmp(r->var,"type")==0)
-               {
-                cur->type=r->v.cstr;
-                r->v.cstr=NULL;
-                l=strlen(cur->type);
-                if (l && cur->type[l-1]=='*')
-                   cur->ispointer=1;
-               }
-             else if (strcmp(r->var,"value")==0)
+             switch (r->atom)
                {
-                cur->value=r->v.cstr;
-                r->v.cstr=NULL;
-               }                     
-             else if (strcmp(r->var,"numchild")==0)
-               {
-                cur->numchild=atoi(r->v.cstr);
+                case at_name:
+                     cur->name=mi_steal_cstr(r);
+                     break;
+                case at_exp:
+                     cur->exp=mi_steal_cstr(r);
+                     break;
+                case at_type:
+                     cur->type=mi_steal_cstr(r);
+                     l=strlen(cur->type);
+                     if (l && cur->type[l-1]=='*')
+                        cur->ispointer=1;
+                     break;
+                case at_value:
+                     cur->value=mi_steal_cstr(r);
+                     break;
+                case at_numchild:
+                     cur->numchild=atoi(r->v.cstr);
+                     break;
                }
             }
           r=r->next;
@@ -1238,50 +2234,51 @@ mi_bkpt *mi_get_bkpt(mi_results *p)
     return NULL;
  while (p)
    {
-    if (p->type==t_const && p->var)
+    if (p->type==t_const)
       {
-       if (strcmp(p->var,"number")==0)
-          res->number=atoi(p->v.cstr);
-       else if (strcmp(p->var,"type")==0)
-         {
-          if (strcmp(p->v.cstr,"breakpoint")==0)
-             res->type=t_breakpoint;
-          else
-             res->type=t_unknown;
-         }
-       else if (strcmp(p->var,"disp")==0)
-         {
-          if (strcmp(p->v.cstr,"keep")==0)
-             res->disp=d_keep;
-          else if (strcmp(p->v.cstr,"del")==0)
-             res->disp=d_del;
-          else
-             res->disp=d_unknown;
-         }
-       else if (strcmp(p->var,"enabled")==0)
-          res->enabled=p->v.cstr[0]=='y';
-       else if (strcmp(p->var,"addr")==0)
-          res->addr=(void *)strtoul(p->v.cstr,&end,0);
-       else if (strcmp(p->var,"func")==0)
-         {
-          res->func=p->v.cstr;
-          p->v.cstr=NULL;
-         }
-       else if (strcmp(p->var,"file")==0)
-         {
-          res->file=p->v.cstr;
-          p->v.cstr=NULL;
-         }
-       else if (strcmp(p->var,"line")==0)
-          res->line=atoi(p->v.cstr);
-       else if (strcmp(p->var,"times")==0)
-          res->times=atoi(p->v.cstr);
-       else if (strcmp(p->var,"ignore")==0)
-          res->ignore=atoi(p->v.cstr);
-       else if (strcmp(p->var,"cond")==0)
+       switch (p->atom)
          {
-          res->cond=p->v.cstr;
-          p->v.cstr=NULL;
+          case at_number:
+               res->number=atoi(p->v.cstr);
+               break;
+          case at_type:
+               if (strcmp(p->v.cstr,"breakpoint")==0)
+                  res->type=t_breakpoint;
+               else
+                  res->type=t_unknown;
+               break;
+          case at_disp:
+               if (strcmp(p->v.cstr,"keep")==0)
+                  res->disp=d_keep;
+               else if (strcmp(p->v.cstr,"del")==0)
+                  res->disp=d_del;
+               else
+                  res->disp=d_unknown;
+               break;
+          case at_enabled:
+               res->enabled=p->v.cstr[0]=='y';
+               break;
+          case at_addr:
+               res->addr=(void *)strtoul(p->v.cstr,&end,0);
+               break;
+          case at_func:
+               res->func=mi_steal_cstr(p);
+               break;
+          case at_file:
+               res->file=mi_steal_cstr(p);
+               break;
+          case at_line:
+               res->line=atoi(p->v.cstr);
+               break;
+          case at_times:
+               res->times=atoi(p->v.cstr);
+               break;
+          case at_ignore:
+               res->ignore=atoi(p->v.cstr);
+               break;
+          case at_cond:
+               res->cond=mi_steal_cstr(p);
+               break;
          }
       }
     p=p->next;
@@ -1317,10 +2314,7 @@ mi_wp *mi_get_wp(mi_results *p, enum mi_wp_mode m)
              res->enabled=1;
             }
           else if (strcmp(p->var,"exp")==0)
-            {
-             res->exp=p->v.cstr;
-             p->v.cstr=NULL;
-            }
+             res->exp=mi_steal_cstr(p);
          }
        p=p->next;
       }
@@ -1377,10 +2371,7 @@ char *mi_res_value(mi_h *h)
  char *s=NULL;
 
  if (r && r->type==t_const)
-   {
-    s=r->v.cstr;
-    r->v.rs=NULL;
-   }
+    s=mi_steal_cstr(r);
  mi_free_results(r);
  return s;
 }
@@ -1443,7 +2434,7 @@ char *reason_expl[]=
 
 enum mi_stop_reason mi_reason_str_to_enum(const char *s)
 {
- int i;
+ unsigned i;
 
  for (i=0; i<sizeof(reason_names)/sizeof(char *); i++)
      if (strcmp(reason_names[i],s)==0)
@@ -1453,7 +2444,7 @@ enum mi_stop_reason mi_reason_str_to_enum(const char *s)
 
 const char *mi_reason_enum_to_str(enum mi_stop_reason r)
 {
- int i;
+ unsigned i;
 
  if (r==sr_unknown)
     return "Unknown (temp bkp?)";
@@ -1473,77 +2464,87 @@ mi_stop *mi_get_stopped(mi_results *r)
       {
        if (r->type==t_const)
          {
-          if (strcmp(r->var,"reason")==0)
-             res->reason=mi_reason_str_to_enum(r->v.cstr);
-          else if (!res->have_thread_id && strcmp(r->var,"thread-id")==0)
-            {
-             res->have_thread_id=1;
-             res->thread_id=atoi(r->v.cstr);
-            }
-          else if (!res->have_bkptno && strcmp(r->var,"bkptno")==0)
-            {
-             res->have_bkptno=1;
-             res->bkptno=atoi(r->v.cstr);
-            }
-          else if (!res->have_bkptno && strcmp(r->var,"wpnum")==0)
-            {
-             res->have_wpno=1;
-             res->wpno=atoi(r->v.cstr);
-            }
-          else if (strcmp(r->var,"gdb-result-var")==0)
-            {
-             res->gdb_result_var=r->v.cstr;
-             r->v.cstr=NULL;
-            }
-          else if (strcmp(r->var,"return-value")==0)
-            {
-             res->return_value=r->v.cstr;
-             r->v.cstr=NULL;
-            }
-          else if (strcmp(r->var,"signal-name")==0)
-            {
-             res->signal_name=r->v.cstr;
-             r->v.cstr=NULL;
-            }
-          else if (strcmp(r->var,"signal-meaning")==0)
-            {
-             res->signal_meaning=r->v.cstr;
-             r->v.cstr=NULL;
-            }
-          else if (!res->have_exit_code && strcmp(r->var,"exit-code")==0)
+          switch (r->atom)
             {
-             res->have_exit_code=1;
-             res->exit_code=atoi(r->v.cstr);
+             case at_reason:
+                  res->reason=mi_reason_str_to_enum(r->v.cstr);
+                  break;
+             case at_thread_id:
+                  if (!res->have_thread_id)
+                    {
+                     res->have_thread_id=1;
+                     res->thread_id=atoi(r->v.cstr);
+                    }
+                  break;
+             case at_bkptno:
+                  if (!res->have_bkptno)
+                    {
+                     res->have_bkptno=1;
+                     res->bkptno=atoi(r->v.cstr);
+                    }
+                  break;
+             case at_wpnum:
+                  if (!res->have_bkptno)
+                    {
+                     res->have_wpno=1;
+                     res->wpno=atoi(r->v.cstr);
+                    }
+                  break;
+             case at_gdb_result_var:
+                  res->gdb_result_var=mi_steal_cstr(r);
+                  break;
+             case at_return_value:
+                  res->return_value=mi_steal_cstr(r);
+                  break;
+             case at_signal_name:
+                  res->signal_name=mi_steal_cstr(r);
+                  break;
+             case at_signal_meaning:
+                  res->signal_meaning=mi_steal_cstr(r);
+                  break;
+             case at_exit_code:
+                  if (!res->have_exit_code)
+                    {
+                     res->have_exit_code=1;
+                     res->exit_code=atoi(r->v.cstr);
+                    }
+                  break;
             }
          }
        else // tuple or list
          {
-          if (strcmp(r->var,"frame")==0)
-             res->frame=mi_parse_frame(r->v.rs);
-          else if (!res->wp && strcmp(r->var,"wpt")==0)
-             res->wp=mi_get_wp(r->v.rs,wm_write);
-          else if (!res->wp && strcmp(r->var,"hw-rwpt")==0)
-             res->wp=mi_get_wp(r->v.rs,wm_read);
-          else if (!res->wp && strcmp(r->var,"hw-awpt")==0)
-             res->wp=mi_get_wp(r->v.rs,wm_rw);
-          else if (!(res->wp_old || res->wp_val) && strcmp(r->var,"value")==0)
-             {
-              mi_results *p=r->v.rs;
-              while (p)
-                {
-                 if (strcmp(p->var,"value")==0 || strcmp(p->var,"new")==0)
-                   {
-                    res->wp_val=p->v.cstr;
-                    p->v.cstr=NULL;
-                   }
-                 else if (strcmp(p->var,"old")==0)
-                   {
-                    res->wp_old=p->v.cstr;
-                    p->v.cstr=NULL;
-                   }
-                 p=p->next;
-                }
-             }
+          switch (r->atom)
+            {
+             case at_frame:
+                  res->frame=mi_parse_frame(r->v.rs);
+                  break;
+             case at_wpt:
+                  if (!res->wp)
+                     res->wp=mi_get_wp(r->v.rs,wm_write);
+                  break;
+             case at_hw_rwpt:
+                  if (!res->wp)
+                     res->wp=mi_get_wp(r->v.rs,wm_read);
+                  break;
+             case at_hw_awpt:
+                  if (!res->wp)
+                     res->wp=mi_get_wp(r->v.rs,wm_rw);
+                  break;
+             case at_value:
+                  if (!(res->wp_old || res->wp_val))
+                    {
+                     mi_results *p=r->v.rs;
+                     while (p)
+                       {
+                        if (p->atom==at_value || p->atom==at_new)
+                           res->wp_val=mi_steal_cstr(p);
+                        else if (p->atom==at_old)
+                           res->wp_old=mi_steal_cstr(p);
+                        p=p->next;
+                       }
+                    }
+                  break;
+            }
          }
        r=r->next;
       }
@@ -1563,57 +2564,193 @@ mi_stop *mi_res_stop(mi_h *h)
        stop=mi_get_stopped(sr->c);
    }
  mi_free_output(o);
+ /* Refresh the registers and compare the tracked memory with the
+    previous stop. */
+ if (stop && stop->reason!=sr_exited_signalled &&
+     stop->reason!=sr_exited && stop->reason!=sr_exited_normally)
+   {
+    if (h->rcache)
+       gmi_update_reg_cache(h);
+    if (h->mtrack)
+       gmi_update_tracked_memory(h);
+   }
 
  return stop;
 }
 
+/* Collects the first row of -data-read-memory from events. */
+typedef struct
+{
+ unsigned char *dest;
+ int *na;
+ unsigned long *addr;
+ int ok, row;
+ char in_mem, in_data, first;
+} mi_mem_ev;
+
+static
+void mi_mem_ev_cb(mi_event *e, void *data)
+{
+ mi_mem_ev *s=(mi_mem_ev *)data;
+ char *end;
+
+ switch (e->type)
+   {
+    case ev_list:
+         if (e->depth==0 && e->atom==at_memory)
+            s->in_mem=1;
+         else if (s->in_mem && s->row==1 && e->depth==2 && e->atom==at_data)
+           {
+            s->ok++;
+            s->in_data=s->first=1;
+           }
+         break;
+    case ev_tuple:
+         if (s->in_mem && e->depth==1)
+            s->row++;
+         break;
+    case ev_end:
+         if (e->depth==2)
+            s->in_data=0;
+         else if (e->depth==0)
+            s->in_mem=0;
+         break;
+    case ev_value:
+         if (s->in_data && e->depth==3)
+           {
+            if (s->first && strcmp(e->val,"N/A")==0)
+              {
+               *s->na=1;
+               s->in_data=0;
+              }
+            else
+               *(s->dest++)=strtol(e->val,&end,0);
+            s->first=0;
+           }
+         else if (s->in_mem && s->row==1 && e->depth==2 && e->atom==at_addr)
+           {
+            s->ok++;
+            if (s->addr)
+               *s->addr=strtoul(e->val,&end,0);
+           }
+         break;
+   }
+}
+
+/* The values are stored in dest as they are parsed, the response isn't
+   converted to a tree. */
 int mi_get_read_memory(mi_h *h, unsigned char *dest, unsigned ws, int *na,
                        unsigned long *addr)
 {
- char *end;
- mi_results *res=mi_res_done_var(h,"memory"), *r;
- int ok=0;
+ mi_mem_ev s;
+ event_cb old=h->event;
+ void *old_data=h->event_data;
 
  *na=0;
- r=res;
- if (r && r->type==t_list && ws==1)
+ memset(&s,0,sizeof(s));
+ s.dest=dest;
+ s.na=na;
+ s.addr=addr;
+ /* Only bytes are supported. */
+ mi_set_event_cb(h,ws==1 ? mi_mem_ev_cb : NULL,&s);
+ mi_free_output(mi_get_response_blk(h));
+ mi_set_event_cb(h,old,old_data);
+ return s.ok==2;
+}
+
+/* Adds [start,end) to the list of regions, joining it to the last one when
+   they are contiguous. */
+int mi_add_mem_region(mi_mem_region **regions, unsigned long start,
+                      unsigned long end)
+{
+ mi_mem_region *r=*regions, *n;
+
+ while (r && r->next)
+    r=r->next;
+ if (r && r->end==start)
    {
-    r=r->v.rs;
-    if (r->type!=t_tuple)
-      {
-       mi_free_results(res);
-       return 0;
-      }
-    r=r->v.rs;
-    while (r)
-      {
-       if (r->type==t_list && strcmp(r->var,"data")==0)
-         {
-          mi_results *data=r->v.rs;
-          ok++;
-          if (data && data->type==t_const &&
-              strcmp(data->v.cstr,"N/A")==0)
-             *na=1;
-          else
-             while (data)
-               {
-                if (data->type==t_const)
-                   *(dest++)=strtol(data->v.cstr,&end,0);
-                data=data->next;
-               }
-         }
-       else if (r->type==t_const && strcmp(r->var,"addr")==0)
-         {
-          ok++;
-          if (addr)
-             *addr=strtoul(r->v.cstr,&end,0);
-         }
-       r=r->next;
-      }
+    r->end=end;
+    return 1;
+   }
+ n=mi_alloc_mem_region();
+ if (!n)
+    return 0;
+ n->start=start;
+ n->end=end;
+ if (r)
+    r->next=n;
+ else
+    *regions=n;
+ return 1;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Decodes the answer to -data-read-memory-bytes for [addr,addr+size). The
+contents of each block is decoded directly to its place in @var{dest}. gdb
+omits the parts it can't read, the rest is added to @var{regions} (if not
+NULL). ^error means nothing could be read.
+
+  Return: The number of bytes read or -1 if the answer is invalid.
 
+***************************************************************************/
+
+long mi_get_read_memory_bytes(mi_output *o, unsigned long addr,
+                              unsigned long size, unsigned char *dest,
+                              mi_mem_region **regions)
+{
+ mi_output *res=mi_get_rrecord(o);
+ mi_results *mem, *c, *r;
+ unsigned long begin, len;
+ const char *contents;
+ long total=0;
+ char *end;
+
+ if (!res)
+    return -1;
+ if (res->tclass==MI_CL_ERROR)
+    return 0;
+ mem=mi_get_var(res,"memory");
+ if (res->tclass!=MI_CL_DONE || !mem || mem->type!=t_list)
+   {
+    mi_error=MI_PARSER;
+    return -1;
    }
- mi_free_results(res);
- return ok==2;
+ for (c=mem->v.rs; c; c=c->next)
+    {
+     if (c->type!=t_tuple)
+        continue;
+     begin=0;
+     contents=NULL;
+     for (r=c->v.rs; r; r=r->next)
+        {
+         if (r->type!=t_const)
+            continue;
+         switch (r->atom)
+           {
+            case at_begin:
+                 begin=strtoul(r->v.cstr,&end,0);
+                 break;
+            case at_contents:
+                 contents=r->v.cstr;
+                 break;
+           }
+        }
+     if (!contents)
+        continue;
+     len=strlen(contents)/2;
+     if (begin<addr || begin-addr>size || len>size-(begin-addr) ||
+         !mi_hex_decode(dest+(begin-addr),contents,len))
+       {
+        mi_error=MI_PARSER;
+        return -1;
+       }
+     if (regions && len && !mi_add_mem_region(regions,begin,begin+len))
+        return -1;
+     total+=len;
+    }
+ return total;
 }
 
 mi_asm_insn *mi_parse_insn(mi_results *c)
@@ -1643,19 +2780,20 @@ mi_asm_insn *mi_parse_insn(mi_results *c)
          {
           if (sub->type==t_const)
             {
-             if (strcmp(sub->var,"address")==0)
-                cur->addr=(void *)strtoul(sub->v.cstr,&end,0);
-             else if (strcmp(sub->var,"func-name")==0)
-               {
-                cur->func=sub->v.cstr;
-                sub->v.cstr=NULL;
-               }
-             else if (strcmp(sub->var,"offset")==0)
-                cur->offset=atoi(sub->v.cstr);
-             else if (strcmp(sub->var,"inst")==0)
+             switch (sub->atom)
                {
-                cur->inst=sub->v.cstr;
-                sub->v.cstr=NULL;
+                case at_address:
+                     cur->addr=(void *)strtoul(sub->v.cstr,&end,0);
+                     break;
+                case at_func_name:
+                     cur->func=mi_steal_cstr(sub);
+                     break;
+                case at_offset:
+                     cur->offset=atoi(sub->v.cstr);
+                     break;
+                case at_inst:
+                     cur->inst=mi_steal_cstr(sub);
+                     break;
                }
             }
           sub=sub->next;
@@ -1699,10 +2837,7 @@ mi_asm_insns *mi_parse_insns(mi_results *c)
                    if (strcmp(sub->var,"line")==0)
                       cur->line=atoi(sub->v.cstr);
                    else if (strcmp(sub->var,"file")==0)
-                     {
-                      cur->file=sub->v.cstr;
-                      sub->v.cstr=NULL;
-                     }
+                      cur->file=mi_steal_cstr(sub);
                   }
                 else if (sub->type==t_list)
                   {
@@ -1726,15 +2861,415 @@ mi_asm_insns *mi_parse_insns(mi_results *c)
 }
 
 
+/* Builds the instructions from the events of -data-disassemble. */
+typedef struct
+{
+ mi_asm_insns *res, *cur;
+ mi_asm_insn *ins;
+ /* Depth of the instruction tuple we are filling, -1 if none. */
+ int ins_depth;
+ char in_list, error;
+} mi_insns_ev;
+
+static
+int mi_insns_ev_add_line(mi_insns_ev *s)
+{
+ mi_asm_insns *n=mi_alloc_asm_insns();
+
+ if (!n)
+    return 0;
+ if (s->cur)
+    s->cur->next=n;
+ else
+    s->res=n;
+ s->cur=n;
+ s->ins=NULL;
+ return 1;
+}
+
+static
+int mi_insns_ev_add_insn(mi_insns_ev *s)
+{
+ mi_asm_insn *n=mi_alloc_asm_insn();
+
+ if (!n)
+    return 0;
+ if (s->ins)
+    s->ins->next=n;
+ else
+    s->cur->ins=n;
+ s->ins=n;
+ return 1;
+}
+
+static
+void mi_insns_ev_cb(mi_event *e, void *data)
+{
+ mi_insns_ev *s=(mi_insns_ev *)data;
+ char *end;
+
+ if (s->error)
+    return;
+ switch (e->type)
+   {
+    case ev_list:
+         if (e->depth==0 && e->atom==at_asm_insns)
+            s->in_list=1;
+         break;
+    case ev_tuple:
+         if (!s->in_list)
+            break;
+         if (e->depth==1 && e->atom==at_src_and_asm_line)
+            s->error=!mi_insns_ev_add_line(s);
+         else if ((e->depth==1 && !e->var) || (e->depth==3 && s->cur))
+           {/* An instruction, without source lines they all go to one
+               mi_asm_insns. */
+            if (!s->cur && !mi_insns_ev_add_line(s))
+               s->error=1;
+            else
+              {
+               s->error=!mi_insns_ev_add_insn(s);
+               s->ins_depth=e->depth;
+              }
+           }
+         break;
+    case ev_end:
+         if (e->depth==s->ins_depth)
+            s->ins_depth=-1;
+         else if (e->depth==0)
+            s->in_list=0;
+         break;
+    case ev_value:
+         if (s->ins_depth>=0 && e->depth==s->ins_depth+1)
+           {
+            switch (e->atom)
+              {
+               case at_address:
+                    s->ins->addr=(void *)strtoul(e->val,&end,0);
+                    break;
+               case at_func_name:
+                    s->ins->func=strdup(e->val);
+                    break;
+               case at_offset:
+                    s->ins->offset=atoi(e->val);
+                    break;
+               case at_inst:
+                    s->ins->inst=strdup(e->val);
+                    break;
+               default:
+                    break;
+              }
+           }
+         else if (s->in_list && s->cur && e->depth==2)
+           {
+            if (e->atom==at_line)
+               s->cur->line=atoi(e->val);
+            else if (e->atom==at_file)
+              {
+               free(s->cur->file);
+               s->cur->file=strdup(e->val);
+              }
+           }
+         break;
+   }
+}
+
+/* The instructions are created while parsing, without a tree for the whole
+   response. */
 mi_asm_insns *mi_get_asm_insns(mi_h *h)
 {
- mi_results *r=mi_res_done_var(h,"asm_insns");
- mi_asm_insns *f=NULL;
+ mi_insns_ev s;
+ mi_output *o, *res;
+ event_cb old=h->event;
+ void *old_data=h->event_data;
+
+ memset(&s,0,sizeof(s));
+ s.ins_depth=-1;
+ mi_set_event_cb(h,mi_insns_ev_cb,&s);
+ o=mi_get_response_blk(h);
+ mi_set_event_cb(h,old,old_data);
+ res=mi_get_rrecord(o);
+ if (!res || res->tclass!=MI_CL_DONE || s.error)
+   {
+    mi_free_asm_insns(s.res);
+    s.res=NULL;
+   }
+ mi_free_output(o);
+ return s.res;
+}
+
+/* Builds a mi_asm_block from the events of -data-disassemble. The arrays
+   grow while parsing and are packed in one block at the end. */
+typedef struct
+{
+ unsigned long *addr;
+ unsigned *offset, *func, *inst;
+ int count, cap;
+ int *line, *first;
+ unsigned *file;
+ int nlines, lcap;
+ char *text;
+ size_t tlen, tcap;
+ /* Last function and file names, to store them once. */
+ unsigned last_func, last_file;
+ int ins_depth;
+ char in_list, error;
+} mi_block_ev;
+
+static
+int mi_block_realloc(void **p, int cap, size_t sz)
+{
+ void *aux=realloc(*p,cap*sz);
 
- if (r && r->type==t_list)
-    f=mi_parse_insns(r->v.rs);
- mi_free_results(r);
- return f;
+ if (!aux)
+   {
+    mi_error=MI_OUT_OF_MEMORY;
+    return 0;
+   }
+ *p=aux;
+ return 1;
+}
+
+/* Adds s to the pool, unless it's the same at last. */
+static
+unsigned mi_block_text(mi_block_ev *s, const char *v, unsigned last)
+{
+ size_t len=strlen(v)+1, cap;
+ unsigned ret;
+ char *aux;
+
+ if (last && strcmp(s->text+last,v)==0)
+    return last;
+ if (s->tlen+len>s->tcap)
+   {
+    for (cap=s->tcap ? s->tcap*2 : 4096; cap<s->tlen+len; cap*=2);
+    aux=realloc(s->text,cap);
+    if (!aux)
+      {
+       mi_error=MI_OUT_OF_MEMORY;
+       s->error=1;
+       return 0;
+      }
+    s->text=aux;
+    s->tcap=cap;
+   }
+ memcpy(s->text+s->tlen,v,len);
+ ret=s->tlen;
+ s->tlen+=len;
+ return ret;
+}
+
+static
+int mi_block_add_line(mi_block_ev *s)
+{
+ int cap;
+
+ if (s->nlines==s->lcap)
+   {
+    cap=s->lcap ? s->lcap*2 : 64;
+    if (!mi_block_realloc((void **)&s->line,cap,sizeof(int)) ||
+        !mi_block_realloc((void **)&s->first,cap,sizeof(int)) ||
+        !mi_block_realloc((void **)&s->file,cap,sizeof(unsigned)))
+       return 0;
+    s->lcap=cap;
+   }
+ s->line[s->nlines]=0;
+ s->file[s->nlines]=0;
+ s->first[s->nlines]=s->count;
+ s->nlines++;
+ return 1;
+}
+
+static
+int mi_block_add_insn(mi_block_ev *s)
+{
+ int cap;
+
+ if (s->count==s->cap)
+   {
+    cap=s->cap ? s->cap*2 : 256;
+    if (!mi_block_realloc((void **)&s->addr,cap,sizeof(unsigned long)) ||
+        !mi_block_realloc((void **)&s->offset,cap,sizeof(unsigned)) ||
+        !mi_block_realloc((void **)&s->func,cap,sizeof(unsigned)) ||
+        !mi_block_realloc((void **)&s->inst,cap,sizeof(unsigned)))
+       return 0;
+    s->cap=cap;
+   }
+ s->addr[s->count]=0;
+ s->offset[s->count]=0;
+ s->func[s->count]=0;
+ s->inst[s->count]=0;
+ s->count++;
+ return 1;
+}
+
+static
+void mi_block_ev_cb(mi_event *e, void *data)
+{
+ mi_block_ev *s=(mi_block_ev *)data;
+ char *end;
+ int i=s->count-1;
+
+ if (s->error)
+    return;
+ switch (e->type)
+   {
+    case ev_list:
+         if (e->depth==0 && e->atom==at_asm_insns)
+            s->in_list=1;
+         break;
+    case ev_tuple:
+         if (!s->in_list)
+            break;
+         if (e->depth==1 && e->atom==at_src_and_asm_line)
+            s->error=!mi_block_add_line(s);
+         else if ((e->depth==1 && !e->var) || (e->depth==3 && s->nlines))
+           {
+            s->error=!mi_block_add_insn(s);
+            s->ins_depth=e->depth;
+           }
+         break;
+    case ev_end:
+         if (e->depth==s->ins_depth)
+            s->ins_depth=-1;
+         else if (e->depth==0)
+            s->in_list=0;
+         break;
+    case ev_value:
+         if (s->ins_depth>=0 && e->depth==s->ins_depth+1)
+           {
+            switch (e->atom)
+              {
+               case at_address:
+                    s->addr[i]=strtoul(e->val,&end,0);
+                    break;
+               case at_func_name:
+                    s->func[i]=s->last_func=
+                      mi_block_text(s,e->val,s->last_func);
+                    break;
+               case at_offset:
+                    s->offset[i]=atoi(e->val);
+                    break;
+               case at_inst:
+                    s->inst[i]=mi_block_text(s,e->val,0);
+                    break;
+               default:
+                    break;
+              }
+           }
+         else if (s->in_list && s->nlines && e->depth==2)
+           {
+            if (e->atom==at_line)
+               s->line[s->nlines-1]=atoi(e->val);
+            else if (e->atom==at_file)
+               s->file[s->nlines-1]=s->last_file=
+                 mi_block_text(s,e->val,s->last_file);
+           }
+         break;
+   }
+}
+
+/* Like mi_get_asm_insns, but creating a mi_asm_block. */
+mi_asm_block *mi_get_asm_block(mi_h *h)
+{
+ mi_block_ev s;
+ mi_output *o, *res;
+ mi_asm_block *b=NULL;
+ event_cb old=h->event;
+ void *old_data=h->event_data;
+
+ memset(&s,0,sizeof(s));
+ s.ins_depth=-1;
+ /* Offset 0 is for missing strings. */
+ mi_block_text(&s,"",0);
+ mi_set_event_cb(h,mi_block_ev_cb,&s);
+ o=mi_get_response_blk(h);
+ mi_set_event_cb(h,old,old_data);
+ res=mi_get_rrecord(o);
+ if (res && res->tclass==MI_CL_DONE && !s.error)
+    b=mi_alloc_asm_block(s.count,s.nlines,s.tlen);
+ if (b)
+   {
+    if (s.count)
+      {
+       memcpy(b->addr,s.addr,s.count*sizeof(unsigned long));
+       memcpy(b->offset,s.offset,s.count*sizeof(unsigned));
+       memcpy(b->func,s.func,s.count*sizeof(unsigned));
+       memcpy(b->inst,s.inst,s.count*sizeof(unsigned));
+      }
+    if (s.nlines)
+      {
+       memcpy(b->line,s.line,s.nlines*sizeof(int));
+       memcpy(b->file,s.file,s.nlines*sizeof(unsigned));
+       memcpy(b->first,s.first,s.nlines*sizeof(int));
+      }
+    b->first[s.nlines]=s.count;
+    memcpy(b->text,s.text,s.tlen);
+   }
+ mi_free_output(o);
+ free(s.addr);
+ free(s.offset);
+ free(s.func);
+ free(s.inst);
+ free(s.line);
+ free(s.first);
+ free(s.file);
+ free(s.text);
+ return b;
+}
+
+/* Creates the lists used by gmi_data_disassemble_se from a block. */
+mi_asm_insns *mi_asm_block_to_insns(mi_asm_block *b)
+{
+ mi_asm_insns *res=NULL, *cur=NULL, *n;
+ mi_asm_insn *ins, *last;
+ int l, i, nlines=b->nlines ? b->nlines : 1, first, end;
+
+ if (!b->count && !b->nlines)
+    return NULL;
+ for (l=0; l<nlines; l++)
+    {
+     n=mi_alloc_asm_insns();
+     if (!n)
+        goto error;
+     if (cur)
+        cur->next=n;
+     else
+        res=n;
+     cur=n;
+     first=0;
+     end=b->count;
+     if (b->nlines)
+       {
+        n->line=b->line[l];
+        if (b->file[l] && !(n->file=strdup(b->text+b->file[l])))
+           goto error;
+        first=b->first[l];
+        end=b->first[l+1];
+       }
+     for (i=first, last=NULL; i<end; i++)
+        {
+         ins=mi_alloc_asm_insn();
+         if (!ins)
+            goto error;
+         if (last)
+            last->next=ins;
+         else
+            n->ins=ins;
+         last=ins;
+         ins->addr=(void *)b->addr[i];
+         ins->offset=b->offset[i];
+         if ((b->func[i] && !(ins->func=strdup(b->text+b->func[i]))) ||
+             (b->inst[i] && !(ins->inst=strdup(b->text+b->inst[i]))))
+            goto error;
+        }
+    }
+ return res;
+
+error:
+ mi_error=MI_OUT_OF_MEMORY;
+ mi_free_asm_insns(res);
+ return NULL;
 }
 
 mi_chg_reg *mi_parse_list_regs(mi_results *r, int *how_many)
@@ -1752,9 +3287,8 @@ mi_chg_reg *mi_parse_list_regs(mi_results *r, int *how_many)
           cur=cur->next=mi_alloc_chg_reg();
        else
           first=cur=mi_alloc_chg_reg();
-       cur->name=c->v.cstr;
+       cur->name=mi_steal_cstr(c);
        cur->reg=cregs++;
-       c->v.cstr=NULL;
       }
     c=c->next;
    }
@@ -1830,10 +3364,7 @@ int mi_parse_reg_values(mi_results *r, mi_chg_reg *l)
                   }
                }
              else if (strcmp(c->var,"value")==0)
-               {
-                l->val=c->v.cstr;
-                c->v.cstr=NULL;
-               }
+                l->val=mi_steal_cstr(c);
             }
           c=c->next;
          }
@@ -1863,8 +3394,7 @@ int mi_parse_list_regs_l(mi_results *r, mi_chg_reg *l)
     if (r->type==t_const && !r->var)
       {
        free(l->name);
-       l->name=r->v.cstr;
-       r->v.cstr=NULL;
+       l->name=mi_steal_cstr(r);
        l=l->next;
       }
     r=r->next;
@@ -1909,10 +3439,7 @@ mi_chg_reg *mi_parse_reg_values_l(mi_results *r, int *how_many)
                 (*how_many)++;
                }
              else if (strcmp(c->var,"value")==0)
-               {
-                cur->val=c->v.cstr;
-                c->v.cstr=NULL;
-               }
+                cur->val=mi_steal_cstr(c);
             }
           c=c->next;
          }
@@ -0,0 +1,272 @@
+/**[txh]********************************************************************
+
+  GDB/MI interface library
+  Copyright (c) 2004-2016 by Salvador E. Tropea.
+ 
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+ 
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+ 
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+  Module: Reactor.
+  Comments:
+  Event loop used to drive a lot of gdb sessions from only one thread. The
+output of each gdb is watched using epoll, so that's Linux specific. When
+gdb sends something the completions of the commands sent with
+@x{mi_submit} are called and each complete response (i.e. async stops) is
+passed to the session callback.@p
+  Note that the blocking functions (gmi_*) can still be used from the
+callbacks, but while they wait the other sessions aren't served.@p
+  
+***************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "mi_gdb.h"
+
+#if !defined(__linux__)
+
+mi_reactor *mi_reactor_create(void)
+{
+ return NULL;
+}
+
+void mi_reactor_free(mi_reactor *r)
+{
+}
+
+int mi_reactor_add(mi_reactor *r, mi_h *h, reactor_cb cb, void *data)
+{
+ return 0;
+}
+
+int mi_reactor_remove(mi_reactor *r, mi_h *h)
+{
+ return 0;
+}
+
+int mi_reactor_run_once(mi_reactor *r, int time_out)
+{
+ return -1;
+}
+
+#else
+
+#include <sys/epoll.h>
+#include <errno.h>
+
+#ifndef TEMP_FAILURE_RETRY
+ #define TEMP_FAILURE_RETRY(a) (a)
+#endif
+
+/* Max. number of events we get from each epoll_wait. */
+#define MI_REACTOR_EVENTS 256
+
+/**[txh]********************************************************************
+
+  Description:
+  Creates an event loop to drive many gdb sessions. Add the sessions using
+@x{mi_reactor_add} and then call @x{mi_reactor_run_once} in a loop.
+  
+  Return: The new reactor or NULL on error.
+  
+***************************************************************************/
+
+mi_reactor *mi_reactor_create(void)
+{
+ mi_reactor *r=(mi_reactor *)mi_calloc1(sizeof(mi_reactor));
+
+ if (!r)
+    return NULL;
+ r->epfd=epoll_create1(EPOLL_CLOEXEC);
+ if (r->epfd<0)
+   {
+    free(r);
+    mi_error=MI_PIPE_CREATE;
+    return NULL;
+   }
+ return r;
+}
+
+static
+void mi_release_zombies(mi_reactor *r)
+{
+ mi_session *s, *aux;
+
+ for (s=r->zombies; s; s=aux)
+    {
+     aux=s->next;
+     free(s);
+    }
+ r->zombies=NULL;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Releases the reactor. The sessions aren't closed, just forgotten.
+  
+***************************************************************************/
+
+void mi_reactor_free(mi_reactor *r)
+{
+ mi_session *s, *aux;
+
+ if (!r)
+    return;
+ for (s=r->first; s; s=aux)
+    {
+     aux=s->next;
+     s->h->session=NULL;
+     free(s);
+    }
+ mi_release_zombies(r);
+ close(r->epfd);
+ free(r);
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Adds a gdb session to the reactor. Each complete response (async stops
+and the answers to commands sent without a token) is passed to @var{cb}, the
+callback owns it and must release it using mi_free_output. When gdb dies the
+callback is called with NULL and the session is removed. The answers to
+@x{mi_submit} go to their own completions. Releasing the handle (i.e. using
+@x{mi_disconnect}) removes it from the reactor.
+  
+  Return: !=0 OK
+  
+***************************************************************************/
+
+int mi_reactor_add(mi_reactor *r, mi_h *h, reactor_cb cb, void *data)
+{
+ mi_session *s;
+ struct epoll_event ev;
+
+ if (h->session)
+    return 0;
+ s=(mi_session *)mi_calloc1(sizeof(mi_session));
+ if (!s)
+    return 0;
+ s->h=h;
+ s->reactor=r;
+ s->cb=cb;
+ s->data=data;
+ memset(&ev,0,sizeof(ev));
+ ev.events=EPOLLIN;
+ ev.data.ptr=s;
+ if (epoll_ctl(r->epfd,EPOLL_CTL_ADD,MI_FROM(h),&ev))
+   {
+    free(s);
+    return 0;
+   }
+ s->next=r->first;
+ if (r->first)
+    r->first->prev=s;
+ r->first=s;
+ h->session=s;
+ return 1;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Removes a gdb session from the reactor. It can be called from the
+callbacks.
+  
+  Return: !=0 OK
+  
+***************************************************************************/
+
+int mi_reactor_remove(mi_reactor *r, mi_h *h)
+{
+ mi_session *s=h->session;
+
+ if (!s)
+    return 0;
+ epoll_ctl(r->epfd,EPOLL_CTL_DEL,MI_FROM(h),NULL);
+ if (s->prev)
+    s->prev->next=s->next;
+ else
+    r->first=s->next;
+ if (s->next)
+    s->next->prev=s->prev;
+ h->session=NULL;
+ s->removed=1;
+ if (r->busy)
+   {/* We could have pending events for it. */
+    s->next=r->zombies;
+    r->zombies=s;
+   }
+ else
+    free(s);
+ return 1;
+}
+
+/* Reads all the available responses for a session. */
+static
+void mi_reactor_dispatch(mi_reactor *r, mi_session *s)
+{
+ int ret;
+
+ do
+   {
+    ret=mi_process_input(s->h);
+    if (s->removed)
+       return;
+    if (ret>0)
+       s->cb(s->h,mi_retire_response(s->h),s->data);
+    else if (ret<0)
+      {
+       mi_h *h=s->h;
+       reactor_cb cb=s->cb;
+       void *data=s->data;
+       mi_reactor_remove(r,h);
+       cb(h,NULL,data);
+      }
+   }
+ while (ret>0 && !s->removed);
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Waits up to @var{time_out} milliseconds (-1 is forever) for output from
+any of the sessions and serves all the sessions that are ready.
+  
+  Return: The number of sessions served, 0 on time out and -1 on error.
+  
+***************************************************************************/
+
+int mi_reactor_run_once(mi_reactor *r, int time_out)
+{
+ struct epoll_event ev[MI_REACTOR_EVENTS];
+ int n, i;
+
+ n=TEMP_FAILURE_RETRY(epoll_wait(r->epfd,ev,MI_REACTOR_EVENTS,time_out));
+ if (n<=0)
+    return n;
+ r->busy=1;
+ for (i=0; i<n; i++)
+    {
+     mi_session *s=(mi_session *)ev[i].data.ptr;
+     if (!s->removed)
+        mi_reactor_dispatch(r,s);
+    }
+ r->busy=0;
+ mi_release_zombies(r);
+ return n;
+}
+
+#endif
@@ -0,0 +1,684 @@
+/**[txh]********************************************************************
+
+  GDB/MI interface library
+  Copyright (c) 2004-2016 by Salvador E. Tropea.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+  Module: Register cache.
+  Comments:
+  Copy of the register file of the target. The names are fetched only once,
+and again when we send a command that can change the architecture (loading
+a file, selecting a target, attaching or running). The values are kept in
+an array indexed by register number, at each stop (mi_res_stop or
+MIDebugger::Poll) we ask gdb which registers changed and only fetch these
+values. So the front-ends can read the registers without talking to gdb.@p
+  The first load asks for the names, the change list and all the values at
+once.@p
+  Note that gdb keeps only one list of changed registers, so don't use
+-data-list-changed-registers while the cache is enabled.@p
+  The raw contents of the registers can also be obtained as binary data
+(see @x{gmi_data_list_register_raw}). The size of each register is taken
+from gdb only once, and discarded with the names.@p
+
+***************************************************************************/
+
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include "mi_gdb.h"
+
+static
+void mi_reg_cache_free_names(mi_reg_cache *c)
+{
+ int i;
+
+ for (i=0; i<c->count; i++)
+    {
+     if (c->names)
+        free(c->names[i]);
+     if (c->values)
+        free(c->values[i]);
+    }
+ free(c->names);
+ free(c->values);
+ free(c->changed);
+ c->names=c->values=NULL;
+ c->changed=NULL;
+ c->count=0;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Enables or disables the register cache. The values are obtained using
+the @var{fmt} format. The cache is filled at the next stop, or when you call
+@x{gmi_update_reg_cache}.
+
+  Return: !=0 OK.
+
+***************************************************************************/
+
+int mi_set_reg_cache(mi_h *h, int enable, enum mi_gvar_fmt fmt)
+{
+ if (h->rcache)
+   {
+    mi_reg_cache_free_names(h->rcache);
+    free(h->rcache);
+    h->rcache=NULL;
+   }
+ if (!enable)
+    return 1;
+ h->rcache=(mi_reg_cache *)mi_calloc1(sizeof(mi_reg_cache));
+ if (!h->rcache)
+    return 0;
+ h->rcache->fmt=fmt;
+ return 1;
+}
+
+/* Commands that can change the architecture. */
+static const char *mi_arch_cmds[]=
+{
+ "-file-exec", "-file-symbol", "-target-select", "-target-attach",
+ "-exec-run", "file ", "symbol-file ", "target ", "attach ", "run", NULL
+};
+
+/* Called for each command we send to gdb. */
+void mi_reg_cache_cmd(mi_h *h, const char *cmd)
+{
+ int i;
+
+ if ((!h->rcache || !h->rcache->names) && !h->reg_sizes)
+    return;
+ cmd=mi_cmd_name(cmd);
+ for (i=0; mi_arch_cmds[i]; i++)
+     if (strncmp(cmd,mi_arch_cmds[i],strlen(mi_arch_cmds[i]))==0)
+       {
+        if (h->rcache)
+           mi_reg_cache_free_names(h->rcache);
+        free(h->reg_sizes);
+        h->reg_sizes=NULL;
+        h->nreg_sizes=0;
+        return;
+       }
+}
+
+static
+int mi_reg_cache_names(mi_reg_cache *c, mi_results *r)
+{
+ mi_results *e;
+ int n=0;
+
+ if (!r || r->type!=t_list)
+    return 0;
+ for (e=r->v.rs; e; e=e->next)
+     n++;
+ c->names=(char **)mi_calloc(n ? n : 1,sizeof(char *));
+ c->values=(char **)mi_calloc(n ? n : 1,sizeof(char *));
+ c->changed=(unsigned char *)mi_calloc(n ? n : 1,1);
+ if (!c->names || !c->values || !c->changed)
+   {
+    mi_reg_cache_free_names(c);
+    return 0;
+   }
+ c->count=n;
+ for (e=r->v.rs, n=0; e; e=e->next, n++)
+     if (e->type==t_const && e->v.cstr[0])
+        c->names[n]=strdup(e->v.cstr);
+ return 1;
+}
+
+/* Stores the values from the list of {number,value}. */
+static
+void mi_reg_cache_values(mi_reg_cache *c, mi_results *r, int mark)
+{
+ mi_results *e, *v;
+ const char *val;
+ int reg;
+
+ if (!r || r->type!=t_list)
+    return;
+ for (e=r->v.rs; e; e=e->next)
+    {
+     if (e->type!=t_tuple)
+        continue;
+     reg=-1;
+     val=NULL;
+     for (v=e->v.rs; v; v=v->next)
+        {
+         if (v->type!=t_const)
+            continue;
+         if (v->atom==at_number)
+            reg=atoi(v->v.cstr);
+         else if (v->atom==at_value)
+            val=v->v.cstr;
+        }
+     if (reg<0 || reg>=c->count || !val)
+        continue;
+     free(c->values[reg]);
+     c->values[reg]=strdup(val);
+     if (mark)
+        c->changed[reg]=1;
+    }
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Refreshes the register cache. If we don't have the names they are
+requested together with all the values. Otherwise we ask which registers
+changed and request their values. Called by mi_res_stop, you only need it
+if you don't use mi_res_stop.
+
+  Command: -data-list-register-names -data-list-changed-registers
+-data-list-register-values
+  Return: The number of changed registers or -1 on error.
+
+***************************************************************************/
+
+int gmi_update_reg_cache(mi_h *h)
+{
+ mi_reg_cache *c=h->rcache;
+ mi_results *r, *ch;
+ char fmt, *nums, *s;
+ int tn, tc, tv, n, ret=0;
+
+ if (!c)
+    return -1;
+ fmt=mi_format_enum_to_char((enum mi_gvar_fmt)c->fmt);
+ if (!c->names)
+   {/* Everything in one exchange. The change list sets the reference for
+       the next stop. */
+    tn=mi_send_tk(h,"-data-list-register-names\n");
+    tc=mi_send_tk(h,"-data-list-changed-registers\n");
+    tv=mi_send_tk(h,"-data-list-register-values %c\n",fmt);
+    r=mi_res_done_var_tk(h,tn,"register-names");
+    if (!mi_reg_cache_names(c,r))
+       ret=-1;
+    mi_free_results(r);
+    mi_free_results(mi_res_done_var_tk(h,tc,"changed-registers"));
+    r=mi_res_done_var_tk(h,tv,"register-values");
+    if (ret==0)
+       mi_reg_cache_values(c,r,0);
+    mi_free_results(r);
+    c->stale=0;
+    return ret;
+   }
+
+ tc=mi_send_tk(h,"-data-list-changed-registers\n");
+ ch=mi_res_done_var_tk(h,tc,"changed-registers");
+ if (!ch || ch->type!=t_list)
+   {
+    mi_free_results(ch);
+    return -1;
+   }
+ memset(c->changed,0,c->count);
+ c->stale=0;
+ for (r=ch->v.rs, n=0; r; r=r->next)
+     n++;
+ if (!n)
+   {
+    mi_free_results(ch);
+    return 0;
+   }
+ nums=mi_malloc(n*12+1);
+ if (!nums)
+   {
+    mi_free_results(ch);
+    return -1;
+   }
+ for (r=ch->v.rs, s=nums; r; r=r->next)
+     if (r->type==t_const)
+       {
+        s+=sprintf(s," %d",atoi(r->v.cstr));
+        ret++;
+       }
+ mi_free_results(ch);
+ tv=mi_send_tk(h,"-data-list-register-values %c%s\n",fmt,nums);
+ free(nums);
+ r=mi_res_done_var_tk(h,tv,"register-values");
+ if (!r)
+    ret=-1;
+ mi_reg_cache_values(c,r,1);
+ mi_free_results(r);
+ return ret;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Number of registers in the cache.
+
+  Return: The number of registers, 0 if not yet loaded.
+
+***************************************************************************/
+
+int mi_get_reg_count(mi_h *h)
+{
+ return h->rcache ? h->rcache->count : 0;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Name of the register number @var{reg}, from the cache.
+
+  Return: The name or NULL if unknown. Owned by the cache.
+
+***************************************************************************/
+
+const char *mi_get_reg_name(mi_h *h, int reg)
+{
+ mi_reg_cache *c=h->rcache;
+
+ if (!c || reg<0 || reg>=c->count)
+    return NULL;
+ return c->names[reg];
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Value of the register number @var{reg} at the last stop, from the cache.
+
+  Return: The value or NULL if unknown. Owned by the cache.
+
+***************************************************************************/
+
+const char *mi_get_reg_value(mi_h *h, int reg)
+{
+ mi_reg_cache *c=h->rcache;
+
+ if (!c || reg<0 || reg>=c->count)
+    return NULL;
+ return c->values[reg];
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Indicates if the register number @var{reg} changed at the last stop.
+
+  Return: !=0 if changed.
+
+***************************************************************************/
+
+int mi_get_reg_changed(mi_h *h, int reg)
+{
+ mi_reg_cache *c=h->rcache;
+
+ if (!c || reg<0 || reg>=c->count)
+    return 0;
+ return c->changed[reg];
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Creates a list with the registers that changed at the last stop, in the
+same format used by @x{gmi_data_list_changed_registers} after filling the
+values. Release it using mi_free_chg_reg.
+
+  Return: The list or NULL if none changed.
+
+***************************************************************************/
+
+mi_chg_reg *mi_get_reg_cache_changed(mi_h *h)
+{
+ mi_reg_cache *c=h->rcache;
+ mi_chg_reg *first=NULL, *cur=NULL, *n;
+ int i;
+
+ if (!c)
+    return NULL;
+ for (i=0; i<c->count; i++)
+    {
+     if (!c->changed[i])
+        continue;
+     n=mi_alloc_chg_reg();
+     if (!n)
+        break;
+     n->reg=i;
+     n->name=c->names[i] ? strdup(c->names[i]) : NULL;
+     n->val=c->values[i] ? strdup(c->values[i]) : NULL;
+     n->updated=1;
+     if (cur)
+        cur->next=n;
+     else
+        first=n;
+     cur=n;
+    }
+ return first;
+}
+
+/* Decodes the number at s, digits hex digits with the most significant
+   first (as gdb prints them), to w bytes in the host byte order. */
+static
+int mi_reg_hex(unsigned char *d, const char *s, int digits, int w)
+{
+ char two[2];
+ int pad;
+#if __BYTE_ORDER__==__ORDER_LITTLE_ENDIAN__
+ unsigned char c;
+ int i;
+#endif
+
+ if (digits>2*w)
+    return 0;
+ pad=w-(digits+1)/2;
+ memset(d,0,pad);
+ if (digits & 1)
+   {
+    two[0]='0';
+    two[1]=*s++;
+    if (!mi_hex_decode(d+pad,two,1))
+       return 0;
+    pad++;
+    digits--;
+   }
+ if (!mi_hex_decode(d+pad,s,digits/2))
+    return 0;
+#if __BYTE_ORDER__==__ORDER_LITTLE_ENDIAN__
+ for (i=0; i<w/2; i++)
+    {
+     c=d[i];
+     d[i]=d[w-1-i];
+     d[w-1-i]=c;
+    }
+#endif
+ return 1;
+}
+
+/* Walks the elements of a field of a vector register, "{0x.., 0x..}" or
+   "0x..". All the elements must have the same number of digits, *width
+   is the size of each one. If d isn't NULL they are decoded there, element
+   0 first. Returns the number of elements, 0 if it isn't a list of hex
+   numbers. */
+static
+int mi_reg_field(const char *s, int *width, unsigned char *d)
+{
+ const char *p=s, *e;
+ int n=0, w=0, rep, digits;
+
+ if (*p=='{')
+    p++;
+ while (1)
+   {
+    if (p[0]!='0' || p[1]!='x')
+       return 0;
+    for (e=p+2; isxdigit((unsigned char)*e); e++);
+    digits=e-p-2;
+    if (!digits || (digits & 1) || (w && digits!=2*w))
+       return 0;
+    w=digits/2;
+    rep=1;
+    if (strncmp(e," <repeats ",10)==0)
+      {/* gdb compresses equal elements. */
+       rep=atoi(e+10);
+       e=strchr(e+10,'>');
+       if (rep<1 || !e)
+          return 0;
+       e++;
+      }
+    for (; rep; rep--, n++)
+        if (d && !mi_reg_hex(d+n*w,p+2,digits,w))
+           return 0;
+    p=e;
+    if (*s!='{' || *p!=',')
+       break;
+    for (p++; *p==' '; p++);
+   }
+ if (*s=='{' && *p!='}')
+    return 0;
+ *width=w;
+ return n;
+}
+
+/* Vector registers are printed as an union. We use the field that covers
+   more bytes, "uint128 = 0x.." or "v2_int64 = {0x.., 0x..}" are better
+   than "v4_float = {0x1, 0x2, ...}". */
+static
+const char *mi_reg_best_field(const char *s, int *bsize)
+{
+ const char *best=NULL;
+ int n, w, bn=0, bw=0;
+
+ for (s=strstr(s,"= "); s; s=strstr(s,"= "))
+    {
+     s+=2;
+     n=mi_reg_field(s,&w,NULL);
+     if (n && (n*w>bn*bw || (n*w==bn*bw && n<bn)))
+       {
+        best=s;
+        bn=n;
+        bw=w;
+       }
+    }
+ *bsize=bn*bw;
+ return best;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Decodes the value of a register, obtained using the raw format (fm_raw),
+to @var{d}. Values like "0x0123" are stored in the host byte order. For
+vector registers, printed as an union of arrays, the elements are stored
+one after the other, element 0 first, each one in the host byte order. If
+@var{size} isn't 0 it must be the size of the register and the value is
+zero extended. Use 0 and a NULL @var{d} to find the size.
+
+  Return: The size of the register or -1 if we can't decode the value.
+
+***************************************************************************/
+
+int mi_decode_reg_raw(const char *val, unsigned char *d, int size)
+{
+ const char *e;
+ int digits, w;
+
+ if (val[0]=='0' && val[1]=='x')
+   {
+    for (e=val+2; isxdigit((unsigned char)*e); e++);
+    digits=e-val-2;
+    if (*e || !digits)
+       return -1;
+    if (!size)
+       size=(digits+1)/2;
+    if (d && !mi_reg_hex(d,val+2,digits,size))
+       return -1;
+    return size;
+   }
+ if (*val!='{')
+    return -1;
+ val=mi_reg_best_field(val,&w);
+ if (!val || (size && w!=size))
+    return -1;
+ if (d && !mi_reg_field(val,&w,d))
+    return -1;
+ return w;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Gets the size of each register from gdb. Only done once, until we send a
+command that can change the architecture.
+
+  Command: -data-list-register-values
+  Return: The number of registers or -1 on error.
+
+***************************************************************************/
+
+int gmi_load_reg_sizes(mi_h *h)
+{
+ mi_results *r, *e, *v;
+ const char *val;
+ int reg, n=0;
+
+ if (h->reg_sizes)
+    return h->nreg_sizes;
+ r=mi_res_done_var_tk(h,mi_send_tk(h,"-data-list-register-values r\n"),
+                      "register-values");
+ if (!r || r->type!=t_list)
+   {
+    mi_free_results(r);
+    return -1;
+   }
+ for (e=r->v.rs; e; e=e->next)
+     n++;
+ h->reg_sizes=(int *)mi_calloc(n ? n : 1,sizeof(int));
+ if (!h->reg_sizes)
+   {
+    mi_free_results(r);
+    return -1;
+   }
+ /* Registers gdb can't read (<unavailable>) are left with size 0. */
+ for (e=r->v.rs; e; e=e->next)
+    {
+     if (e->type!=t_tuple)
+        continue;
+     reg=-1;
+     val=NULL;
+     for (v=e->v.rs; v; v=v->next)
+        {
+         if (v->type!=t_const)
+            continue;
+         if (v->atom==at_number)
+            reg=atoi(v->v.cstr);
+         else if (v->atom==at_value)
+            val=v->v.cstr;
+        }
+     if (reg<0 || reg>=n || !val)
+        continue;
+     h->reg_sizes[reg]=mi_decode_reg_raw(val,NULL,0);
+     if (h->reg_sizes[reg]<0)
+        h->reg_sizes[reg]=0;
+    }
+ h->nreg_sizes=n;
+ mi_free_results(r);
+ return n;
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Size in bytes of the register number @var{reg}. The sizes must be loaded
+using @x{gmi_load_reg_sizes}.
+
+  Return: The size, 0 if unknown.
+
+***************************************************************************/
+
+int mi_get_reg_size(mi_h *h, int reg)
+{
+ if (!h->reg_sizes || reg<0 || reg>=h->nreg_sizes)
+    return 0;
+ return h->reg_sizes[reg];
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Reads the contents of the @var{count} registers listed in @var{regs} as
+binary data, see @x{mi_decode_reg_raw} for the format. They are stored one
+after the other in @var{buf}, each one using @x{mi_get_reg_size} bytes. If
+@var{regs} is NULL all the registers are read, in order. The sizes are
+loaded if needed. The values gdb can't read are filled with zeros.@p
+  Useful to compare or hash the state of the registers without parsing
+strings.
+
+  Command: -data-list-register-values
+  Return: The number of bytes stored or -1 on error (i.e. @var{size} is too
+small).
+
+***************************************************************************/
+
+long gmi_data_list_register_raw(mi_h *h, const int *regs, int count,
+                                unsigned char *buf, size_t size)
+{
+ mi_results *r, *e, *v;
+ const char *val;
+ char *nums=NULL, *s;
+ long total=0, *off;
+ int i, reg, k, ret;
+
+ if (gmi_load_reg_sizes(h)<0)
+    return -1;
+ if (!regs)
+    count=h->nreg_sizes;
+ off=(long *)mi_calloc(count ? count : 1,sizeof(long));
+ if (regs)
+    nums=mi_malloc(count*12+1);
+ if (!off || (regs && !nums))
+   {
+    free(off);
+    free(nums);
+    return -1;
+   }
+ for (i=0, s=nums; i<count; i++)
+    {
+     reg=regs ? regs[i] : i;
+     off[i]=total;
+     total+=mi_get_reg_size(h,reg);
+     if (nums)
+        s+=sprintf(s," %d",reg);
+    }
+ if ((size_t)total>size)
+   {
+    free(off);
+    free(nums);
+    return -1;
+   }
+ memset(buf,0,total);
+ r=mi_res_done_var_tk(h,mi_send_tk(h,"-data-list-register-values r%s\n",
+                      nums ? nums : ""),"register-values");
+ free(nums);
+ ret=r && r->type==t_list ? 0 : -1;
+ /* gdb answers in the same order we asked. */
+ for (e=ret ? NULL : r->v.rs, k=0; e && k<count; e=e->next, k++)
+    {
+     if (e->type!=t_tuple)
+        continue;
+     reg=-1;
+     val=NULL;
+     for (v=e->v.rs; v; v=v->next)
+        {
+         if (v->type!=t_const)
+            continue;
+         if (v->atom==at_number)
+            reg=atoi(v->v.cstr);
+         else if (v->atom==at_value)
+            val=v->v.cstr;
+        }
+     if (reg!=(regs ? regs[k] : k))
+       {
+        mi_error=MI_PARSER;
+        ret=-1;
+        break;
+       }
+     if (!val || !mi_get_reg_size(h,reg) || *val=='<')
+        continue;
+     if (mi_decode_reg_raw(val,buf+off[k],mi_get_reg_size(h,reg))<0)
+       {
+        mi_error=MI_PARSER;
+        ret=-1;
+        break;
+       }
+    }
+ mi_free_results(r);
+ free(off);
+ return ret ? -1 : total;
+}
@@ -0,0 +1,679 @@
+/**[txh]********************************************************************
+
+  GDB/MI interface library
+  Copyright (c) 2004-2016 by Salvador E. Tropea.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+  Module: Scanner.
+  Comments:
+  Kernels used by the parser to skip the plain part of the c-strings. They
+look for the next quote or backslash (and EOS or newline) 16 or 32 bytes at
+a time. The SSE2 or AVX2 version is selected at run-time, a scalar one is
+used for other CPUs.
+  Also the decoder and encoder for the hex blobs used by
+-data-read-memory-bytes and -data-write-memory-bytes, and the comparison
+used to find the changes in the tracked memory and the search of byte
+patterns.
+
+***************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+#include "mi_gdb.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+ #define MI_SCAN_X86 1
+ #include <immintrin.h>
+ /* The NUL terminated kernels read the whole aligned block, that's safe
+    because it can't cross a page, but ASan doesn't know it. */
+ #define MI_SCAN_OVER __attribute__((no_sanitize_address))
+#endif
+
+typedef const char *(*scan_cstr_f)(const char *s);
+typedef const char *(*scan_line_f)(const char *s, const char *e);
+typedef int (*hex_decode_f)(unsigned char *d, const char *s, size_t n);
+typedef void (*hex_encode_f)(char *d, const unsigned char *s, size_t n);
+typedef size_t (*mem_diff_f)(const unsigned char *a, const unsigned char *b,
+                             size_t n);
+typedef const unsigned char *(*mem_find_f)(const unsigned char *s, size_t n,
+                                           const unsigned char *p, size_t m);
+
+static const char *mi_scan_cstr_init(const char *s);
+static const char *mi_scan_line_init(const char *s, const char *e);
+static int mi_hex_decode_init(unsigned char *d, const char *s, size_t n);
+static void mi_hex_encode_init(char *d, const unsigned char *s, size_t n);
+static size_t mi_mem_diff_init(const unsigned char *a, const unsigned char *b,
+                               size_t n);
+static const unsigned char *mi_mem_find_init(const unsigned char *s, size_t n,
+                                             const unsigned char *p, size_t m);
+
+static scan_cstr_f scan_cstr=mi_scan_cstr_init;
+static scan_line_f scan_line=mi_scan_line_init;
+static hex_decode_f hex_decode=mi_hex_decode_init;
+static hex_encode_f hex_encode=mi_hex_encode_init;
+static mem_diff_f mem_diff=mi_mem_diff_init;
+static mem_find_f mem_find=mi_mem_find_init;
+
+static
+const char *mi_scan_cstr_scalar(const char *s)
+{
+ while (*s && *s!='"' && *s!='\\')
+    s++;
+ return s;
+}
+
+static
+const char *mi_scan_line_scalar(const char *s, const char *e)
+{
+ while (s<e && *s!='"' && *s!='\\' && *s!='\n')
+    s++;
+ return s;
+}
+
+static inline
+int mi_hex_val(unsigned char c)
+{
+ if (c>='0' && c<='9')
+    return c-'0';
+ c|=0x20;
+ if (c>='a' && c<='f')
+    return c-'a'+10;
+ return -1;
+}
+
+static
+int mi_hex_decode_scalar(unsigned char *d, const char *s, size_t n)
+{
+ int h, l;
+
+ for (; n; n--, s+=2)
+    {
+     h=mi_hex_val(s[0]);
+     l=mi_hex_val(s[1]);
+     if (h<0 || l<0)
+        return 0;
+     *(d++)=h<<4 | l;
+    }
+ return 1;
+}
+
+static
+void mi_hex_encode_scalar(char *d, const unsigned char *s, size_t n)
+{
+ static const char digits[]="0123456789abcdef";
+
+ for (; n; n--, s++)
+    {
+     *(d++)=digits[*s>>4];
+     *(d++)=digits[*s & 15];
+    }
+}
+
+static
+size_t mi_mem_diff_scalar(const unsigned char *a, const unsigned char *b,
+                          size_t n)
+{
+ uint64_t x, y;
+ size_t i=0;
+
+ for (; i+8<=n; i+=8)
+    {
+     memcpy(&x,a+i,8);
+     memcpy(&y,b+i,8);
+     if (x!=y)
+        break;
+    }
+ while (i<n && a[i]==b[i])
+    i++;
+ return i;
+}
+
+static
+const unsigned char *mi_mem_find_scalar(const unsigned char *s, size_t n,
+                                        const unsigned char *p, size_t m)
+{
+ const unsigned char *e;
+
+ if (!m)
+    return s;
+ if (m>n)
+    return NULL;
+ for (e=s+n-m+1; (s=memchr(s,p[0],e-s))!=NULL; s++)
+     if (memcmp(s+1,p+1,m-1)==0)
+        return s;
+ return NULL;
+}
+
+#ifdef MI_SCAN_X86
+__attribute__((target("sse2"))) MI_SCAN_OVER
+static
+const char *mi_scan_cstr_sse2(const char *s)
+{
+ const __m128i q=_mm_set1_epi8('"'), b=_mm_set1_epi8('\\');
+ const __m128i z=_mm_setzero_si128();
+ const char *p=(const char *)((uintptr_t)s & ~(uintptr_t)15);
+ __m128i v;
+ unsigned m;
+
+ v=_mm_load_si128((const __m128i *)p);
+ m=_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v,q),
+                     _mm_cmpeq_epi8(v,b)),_mm_cmpeq_epi8(v,z)));
+ /* Discard what we have before s. */
+ m&=~0u<<(s-p);
+ while (!m)
+   {
+    p+=16;
+    v=_mm_load_si128((const __m128i *)p);
+    m=_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v,q),
+                        _mm_cmpeq_epi8(v,b)),_mm_cmpeq_epi8(v,z)));
+   }
+ return p+__builtin_ctz(m);
+}
+
+__attribute__((target("sse2")))
+static
+const char *mi_scan_line_sse2(const char *s, const char *e)
+{
+ const __m128i q=_mm_set1_epi8('"'), b=_mm_set1_epi8('\\');
+ const __m128i n=_mm_set1_epi8('\n');
+ __m128i v;
+ unsigned m;
+
+ for (; e-s>=16; s+=16)
+    {
+     v=_mm_loadu_si128((const __m128i *)s);
+     m=_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v,q),
+                         _mm_cmpeq_epi8(v,b)),_mm_cmpeq_epi8(v,n)));
+     if (m)
+        return s+__builtin_ctz(m);
+    }
+ return mi_scan_line_scalar(s,e);
+}
+
+/* Converts 16 hex digits to their values, bad is set for invalid ones. */
+__attribute__((target("sse2")))
+static inline
+__m128i mi_hex_nibbles_sse2(__m128i v, __m128i *bad)
+{
+ const __m128i m1=_mm_set1_epi8(-1);
+ __m128i d=_mm_sub_epi8(v,_mm_set1_epi8('0'));
+ __m128i l=_mm_sub_epi8(_mm_or_si128(v,_mm_set1_epi8(0x20)),_mm_set1_epi8('a'));
+ __m128i is_d=_mm_and_si128(_mm_cmpgt_epi8(d,m1),
+                            _mm_cmplt_epi8(d,_mm_set1_epi8(10)));
+ __m128i is_l=_mm_and_si128(_mm_cmpgt_epi8(l,m1),
+                            _mm_cmplt_epi8(l,_mm_set1_epi8(6)));
+
+ *bad=_mm_or_si128(*bad,_mm_andnot_si128(_mm_or_si128(is_d,is_l),m1));
+ return _mm_or_si128(_mm_and_si128(is_d,d),
+                     _mm_and_si128(is_l,_mm_add_epi8(l,_mm_set1_epi8(10))));
+}
+
+/* Joins the pairs of nibbles of each 16 bits word. */
+__attribute__((target("sse2")))
+static inline
+__m128i mi_hex_join_sse2(__m128i v)
+{
+ return _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v,_mm_set1_epi16(0xFF)),4),
+                     _mm_srli_epi16(v,8));
+}
+
+__attribute__((target("sse2")))
+static
+int mi_hex_decode_sse2(unsigned char *d, const char *s, size_t n)
+{
+ __m128i bad=_mm_setzero_si128(), a, b;
+
+ for (; n>=16; n-=16, s+=32, d+=16)
+    {
+     a=mi_hex_nibbles_sse2(_mm_loadu_si128((const __m128i *)s),&bad);
+     b=mi_hex_nibbles_sse2(_mm_loadu_si128((const __m128i *)(s+16)),&bad);
+     _mm_storeu_si128((__m128i *)d,_mm_packus_epi16(mi_hex_join_sse2(a),
+                      mi_hex_join_sse2(b)));
+    }
+ if (_mm_movemask_epi8(bad))
+    return 0;
+ return mi_hex_decode_scalar(d,s,n);
+}
+
+/* Converts nibbles to hex digits. */
+__attribute__((target("sse2")))
+static inline
+__m128i mi_hex_digits_sse2(__m128i v)
+{
+ return _mm_add_epi8(_mm_add_epi8(v,_mm_set1_epi8('0')),
+                     _mm_and_si128(_mm_cmpgt_epi8(v,_mm_set1_epi8(9)),
+                                   _mm_set1_epi8('a'-'0'-10)));
+}
+
+__attribute__((target("sse2")))
+static
+void mi_hex_encode_sse2(char *d, const unsigned char *s, size_t n)
+{
+ const __m128i m=_mm_set1_epi8(15);
+ __m128i v, hi, lo;
+
+ for (; n>=16; n-=16, s+=16, d+=32)
+    {
+     v=_mm_loadu_si128((const __m128i *)s);
+     hi=_mm_and_si128(_mm_srli_epi16(v,4),m);
+     lo=_mm_and_si128(v,m);
+     _mm_storeu_si128((__m128i *)d,
+                      mi_hex_digits_sse2(_mm_unpacklo_epi8(hi,lo)));
+     _mm_storeu_si128((__m128i *)(d+16),
+                      mi_hex_digits_sse2(_mm_unpackhi_epi8(hi,lo)));
+    }
+ mi_hex_encode_scalar(d,s,n);
+}
+
+__attribute__((target("sse2")))
+static
+size_t mi_mem_diff_sse2(const unsigned char *a, const unsigned char *b,
+                        size_t n)
+{
+ unsigned m;
+ size_t i;
+
+ for (i=0; i+16<=n; i+=16)
+    {
+     m=_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a+i)),
+                         _mm_loadu_si128((const __m128i *)(b+i))));
+     if (m!=0xFFFF)
+        return i+__builtin_ctz(~m);
+    }
+ return i+mi_mem_diff_scalar(a+i,b+i,n-i);
+}
+
+/* Looks for the first and the last byte of the pattern 16 positions at a
+   time, only the candidates are compared. */
+__attribute__((target("sse2")))
+static
+const unsigned char *mi_mem_find_sse2(const unsigned char *s, size_t n,
+                                      const unsigned char *p, size_t m)
+{
+ __m128i f, l;
+ unsigned mask;
+ size_t i;
+
+ if (m<2 || m>n)
+    return mi_mem_find_scalar(s,n,p,m);
+ f=_mm_set1_epi8(p[0]);
+ l=_mm_set1_epi8(p[m-1]);
+ for (i=0; i+m-1+16<=n; i+=16)
+    {
+     mask=_mm_movemask_epi8(_mm_and_si128(
+          _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(s+i)),f),
+          _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(s+i+m-1)),l)));
+     for (; mask; mask&=mask-1)
+         if (memcmp(s+i+__builtin_ctz(mask)+1,p+1,m-2)==0)
+            return s+i+__builtin_ctz(mask);
+    }
+ return mi_mem_find_scalar(s+i,n-i,p,m);
+}
+
+__attribute__((target("avx2"))) MI_SCAN_OVER
+static
+const char *mi_scan_cstr_avx2(const char *s)
+{
+ const __m256i q=_mm256_set1_epi8('"'), b=_mm256_set1_epi8('\\');
+ const __m256i z=_mm256_setzero_si256();
+ const char *p=(const char *)((uintptr_t)s & ~(uintptr_t)31);
+ __m256i v;
+ unsigned m;
+
+ v=_mm256_load_si256((const __m256i *)p);
+ m=_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(
+                        _mm256_cmpeq_epi8(v,q),_mm256_cmpeq_epi8(v,b)),
+                        _mm256_cmpeq_epi8(v,z)));
+ m&=~0u<<(s-p);
+ while (!m)
+   {
+    p+=32;
+    v=_mm256_load_si256((const __m256i *)p);
+    m=_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(
+                           _mm256_cmpeq_epi8(v,q),_mm256_cmpeq_epi8(v,b)),
+                           _mm256_cmpeq_epi8(v,z)));
+   }
+ return p+__builtin_ctz(m);
+}
+
+__attribute__((target("avx2")))
+static
+const char *mi_scan_line_avx2(const char *s, const char *e)
+{
+ const __m256i q=_mm256_set1_epi8('"'), b=_mm256_set1_epi8('\\');
+ const __m256i n=_mm256_set1_epi8('\n');
+ __m256i v;
+ unsigned m;
+
+ for (; e-s>=32; s+=32)
+    {
+     v=_mm256_loadu_si256((const __m256i *)s);
+     m=_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(
+                            _mm256_cmpeq_epi8(v,q),_mm256_cmpeq_epi8(v,b)),
+                            _mm256_cmpeq_epi8(v,n)));
+     if (m)
+        return s+__builtin_ctz(m);
+    }
+ return mi_scan_line_sse2(s,e);
+}
+
+__attribute__((target("avx2")))
+static inline
+__m256i mi_hex_nibbles_avx2(__m256i v, __m256i *bad)
+{
+ const __m256i m1=_mm256_set1_epi8(-1);
+ __m256i d=_mm256_sub_epi8(v,_mm256_set1_epi8('0'));
+ __m256i l=_mm256_sub_epi8(_mm256_or_si256(v,_mm256_set1_epi8(0x20)),
+                           _mm256_set1_epi8('a'));
+ __m256i is_d=_mm256_and_si256(_mm256_cmpgt_epi8(d,m1),
+                               _mm256_cmpgt_epi8(_mm256_set1_epi8(10),d));
+ __m256i is_l=_mm256_and_si256(_mm256_cmpgt_epi8(l,m1),
+                               _mm256_cmpgt_epi8(_mm256_set1_epi8(6),l));
+
+ *bad=_mm256_or_si256(*bad,_mm256_andnot_si256(_mm256_or_si256(is_d,is_l),m1));
+ return _mm256_or_si256(_mm256_and_si256(is_d,d),
+                        _mm256_and_si256(is_l,_mm256_add_epi8(l,
+                                         _mm256_set1_epi8(10))));
+}
+
+__attribute__((target("avx2")))
+static inline
+__m256i mi_hex_join_avx2(__m256i v)
+{
+ return _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(v,
+                        _mm256_set1_epi16(0xFF)),4),_mm256_srli_epi16(v,8));
+}
+
+__attribute__((target("avx2")))
+static
+int mi_hex_decode_avx2(unsigned char *d, const char *s, size_t n)
+{
+ __m256i bad=_mm256_setzero_si256(), a, b;
+
+ for (; n>=32; n-=32, s+=64, d+=32)
+    {
+     a=mi_hex_nibbles_avx2(_mm256_loadu_si256((const __m256i *)s),&bad);
+     b=mi_hex_nibbles_avx2(_mm256_loadu_si256((const __m256i *)(s+32)),&bad);
+     /* The pack works on each 128 bits lane, fix the order. */
+     _mm256_storeu_si256((__m256i *)d,_mm256_permute4x64_epi64(
+                         _mm256_packus_epi16(mi_hex_join_avx2(a),
+                         mi_hex_join_avx2(b)),0xD8));
+    }
+ if (_mm256_movemask_epi8(bad))
+    return 0;
+ return mi_hex_decode_sse2(d,s,n);
+}
+
+__attribute__((target("avx2")))
+static inline
+__m256i mi_hex_digits_avx2(__m256i v)
+{
+ return _mm256_add_epi8(_mm256_add_epi8(v,_mm256_set1_epi8('0')),
+                        _mm256_and_si256(_mm256_cmpgt_epi8(v,
+                                         _mm256_set1_epi8(9)),
+                                         _mm256_set1_epi8('a'-'0'-10)));
+}
+
+__attribute__((target("avx2")))
+static
+void mi_hex_encode_avx2(char *d, const unsigned char *s, size_t n)
+{
+ const __m256i m=_mm256_set1_epi8(15);
+ __m256i v, hi, lo, a, b;
+
+ for (; n>=32; n-=32, s+=32, d+=64)
+    {
+     v=_mm256_loadu_si256((const __m256i *)s);
+     hi=_mm256_and_si256(_mm256_srli_epi16(v,4),m);
+     lo=_mm256_and_si256(v,m);
+     /* The unpack works on each 128 bits lane, join the low halves and then
+        the high halves. */
+     a=mi_hex_digits_avx2(_mm256_unpacklo_epi8(hi,lo));
+     b=mi_hex_digits_avx2(_mm256_unpackhi_epi8(hi,lo));
+     _mm256_storeu_si256((__m256i *)d,_mm256_permute2x128_si256(a,b,0x20));
+     _mm256_storeu_si256((__m256i *)(d+32),_mm256_permute2x128_si256(a,b,0x31));
+    }
+ mi_hex_encode_sse2(d,s,n);
+}
+
+__attribute__((target("avx2")))
+static
+size_t mi_mem_diff_avx2(const unsigned char *a, const unsigned char *b,
+                        size_t n)
+{
+ unsigned m;
+ size_t i;
+
+ for (i=0; i+32<=n; i+=32)
+    {
+     m=_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+                            _mm256_loadu_si256((const __m256i *)(a+i)),
+                            _mm256_loadu_si256((const __m256i *)(b+i))));
+     if (m!=0xFFFFFFFFu)
+        return i+__builtin_ctz(~m);
+    }
+ return i+mi_mem_diff_sse2(a+i,b+i,n-i);
+}
+
+__attribute__((target("avx2")))
+static
+const unsigned char *mi_mem_find_avx2(const unsigned char *s, size_t n,
+                                      const unsigned char *p, size_t m)
+{
+ __m256i f, l;
+ unsigned mask;
+ size_t i;
+
+ if (m<2 || m>n)
+    return mi_mem_find_scalar(s,n,p,m);
+ f=_mm256_set1_epi8(p[0]);
+ l=_mm256_set1_epi8(p[m-1]);
+ for (i=0; i+m-1+32<=n; i+=32)
+    {
+     mask=_mm256_movemask_epi8(_mm256_and_si256(
+          _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(s+i)),f),
+          _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(s+i+m-1)),l)));
+     for (; mask; mask&=mask-1)
+         if (memcmp(s+i+__builtin_ctz(mask)+1,p+1,m-2)==0)
+            return s+i+__builtin_ctz(mask);
+    }
+ return mi_mem_find_sse2(s+i,n-i,p,m);
+}
+#endif
+
+/**[txh]********************************************************************
+
+  Description:
+  Selects the kernels used to scan c-strings. Valid names are "scalar",
+"sse2" and "avx2", NULL selects the best one for this CPU. Mainly useful
+to compare them.
+
+  Return: The name of the selected kernels or NULL if not available.
+
+***************************************************************************/
+
+const char *mi_scan_select(const char *name)
+{
+ #ifdef MI_SCAN_X86
+ __builtin_cpu_init();
+ if (!name)
+    name=__builtin_cpu_supports("avx2") ? "avx2" :
+         __builtin_cpu_supports("sse2") ? "sse2" : "scalar";
+ if (strcmp(name,"avx2")==0 && __builtin_cpu_supports("avx2"))
+   {
+    scan_cstr=mi_scan_cstr_avx2;
+    scan_line=mi_scan_line_avx2;
+    hex_decode=mi_hex_decode_avx2;
+    hex_encode=mi_hex_encode_avx2;
+    mem_diff=mi_mem_diff_avx2;
+    mem_find=mi_mem_find_avx2;
+    return "avx2";
+   }
+ if (strcmp(name,"sse2")==0 && __builtin_cpu_supports("sse2"))
+   {
+    scan_cstr=mi_scan_cstr_sse2;
+    scan_line=mi_scan_line_sse2;
+    hex_decode=mi_hex_decode_sse2;
+    hex_encode=mi_hex_encode_sse2;
+    mem_diff=mi_mem_diff_sse2;
+    mem_find=mi_mem_find_sse2;
+    return "sse2";
+   }
+ #endif
+ if (!name || strcmp(name,"scalar")==0)
+   {
+    scan_cstr=mi_scan_cstr_scalar;
+    scan_line=mi_scan_line_scalar;
+    hex_decode=mi_hex_decode_scalar;
+    hex_encode=mi_hex_encode_scalar;
+    mem_diff=mi_mem_diff_scalar;
+    mem_find=mi_mem_find_scalar;
+    return "scalar";
+   }
+ return NULL;
+}
+
+/* The first call selects the kernels. */
+static
+const char *mi_scan_cstr_init(const char *s)
+{
+ mi_scan_select(NULL);
+ return scan_cstr(s);
+}
+
+static
+const char *mi_scan_line_init(const char *s, const char *e)
+{
+ mi_scan_select(NULL);
+ return scan_line(s,e);
+}
+
+static
+int mi_hex_decode_init(unsigned char *d, const char *s, size_t n)
+{
+ mi_scan_select(NULL);
+ return hex_decode(d,s,n);
+}
+
+static
+void mi_hex_encode_init(char *d, const unsigned char *s, size_t n)
+{
+ mi_scan_select(NULL);
+ hex_encode(d,s,n);
+}
+
+static
+size_t mi_mem_diff_init(const unsigned char *a, const unsigned char *b,
+                        size_t n)
+{
+ mi_scan_select(NULL);
+ return mem_diff(a,b,n);
+}
+
+static
+const unsigned char *mi_mem_find_init(const unsigned char *s, size_t n,
+                                      const unsigned char *p, size_t m)
+{
+ mi_scan_select(NULL);
+ return mem_find(s,n,p,m);
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Finds the next quote, backslash or EOS in a NUL terminated string.
+
+  Return: A pointer to the char found.
+
+***************************************************************************/
+
+const char *mi_scan_cstr(const char *s)
+{
+ return scan_cstr(s);
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Finds the next quote, backslash or newline in [s,e).
+
+  Return: A pointer to the char found or e.
+
+***************************************************************************/
+
+const char *mi_scan_line(const char *s, const char *e)
+{
+ return scan_line(s,e);
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Decodes @var{n} bytes from the 2*@var{n} hex digits at @var{s}.
+
+  Return: !=0 OK, 0 if @var{s} contains something that isn't a hex digit.
+The contents of @var{d} is undefined in this case.
+
+***************************************************************************/
+
+int mi_hex_decode(unsigned char *d, const char *s, size_t n)
+{
+ return hex_decode(d,s,n);
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Encodes @var{n} bytes from @var{s} as 2*@var{n} lowercase hex digits. No
+EOS is added.
+
+***************************************************************************/
+
+void mi_hex_encode(char *d, const unsigned char *s, size_t n)
+{
+ hex_encode(d,s,n);
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Compares @var{n} bytes of @var{a} and @var{b}.
+
+  Return: The offset of the first byte that differs or @var{n} if they are
+equal.
+
+***************************************************************************/
+
+size_t mi_mem_diff(const unsigned char *a, const unsigned char *b, size_t n)
+{
+ return mem_diff(a,b,n);
+}
+
+/**[txh]********************************************************************
+
+  Description:
+  Finds the first occurrence of the @var{m} bytes at @var{p} in the @var{n}
+bytes at @var{s}, like memmem.
+
+  Return: A pointer to the occurrence or NULL if not found.
+
+***************************************************************************/
+
+const unsigned char *mi_mem_find(const unsigned char *s, size_t n,
+                                 const unsigned char *p, size_t m)
+{
+ return mem_find(s,n,p,m);
+}